@@ -0,0 +1,502 @@
+// Compiler throughput benchmark.
+//
+//   bench gen [params]           writes a synthetic program to stdout
+//   bench run [--foxc path] [--quick]
+//                                runs scaling sweeps over synthetic programs
+//
+// Programs only use the subset of C that foxc supports. Each sweep doubles
+// one generator parameter at a time and reports the throughput of each phase
+// (taken from 'foxc --stats') along with peak RSS. For every phase the
+// scaling exponent of time against input size is estimated, and exponents
+// noticeably above 1 are flagged as super-linear.
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+// Exponents above this are reported as super-linear.
+#define SUPER_LINEAR_THRESHOLD 1.25
+
+// Number of times each measurement is repeated, the fastest run is kept.
+#define REPEATS 3
+
+typedef struct
+{
+	int functions;   // number of functions in the program
+	int stmts;       // statements per function
+	int depth;       // maximum expression depth
+	int idents;      // distinct local variables per function
+	int literal_pct; // percentage of expression leaves which are literals
+	uint32_t seed;
+} gen_params_t;
+
+static const gen_params_t default_params =
+{
+	.functions = 200,
+	.stmts = 50,
+	.depth = 8,
+	.idents = 16,
+	.literal_pct = 40,
+	.seed = 1
+};
+
+//
+// Program generator.
+//
+
+static struct
+{
+	FILE* out;
+	const gen_params_t* params;
+	uint32_t rng;
+	int function;
+} gen;
+
+// xorshift32, so the output only depends on the seed.
+static uint32_t rand_next()
+{
+	uint32_t x = gen.rng;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	gen.rng = x;
+	return x;
+}
+
+static int rand_range(int n)
+{
+	return rand_next() % n;
+}
+
+static void gen_var(int i)
+{
+	fprintf(gen.out, "v%d_%d", gen.function, i);
+}
+
+static void gen_leaf()
+{
+	if(rand_range(100) < gen.params->literal_pct)
+	{
+		fprintf(gen.out, "%d", rand_range(100000));
+	}
+	else
+	{
+		gen_var(rand_range(gen.params->idents));
+	}
+}
+
+// Generates an expression whose depth is at most 'depth'. Each level adds a
+// single operator, so the size of an expression is linear in its depth.
+static void gen_expr(int depth)
+{
+	static const char* operators[] =
+	{
+		"+", "-", "*", "&", "|", "^", "<<", ">>",
+		"<", "<=", ">", ">=", "==", "!=", "&&", "||"
+	};
+	static const char* unary_operators[] = { "-", "~", "!" };
+
+	if(depth == 0)
+	{
+		gen_leaf();
+		return;
+	}
+
+	int choice = rand_range(100);
+	if(choice < 10)
+	{
+		fprintf(gen.out, "%s", unary_operators[rand_range(3)]);
+		gen_expr(depth - 1);
+	}
+	else if(choice < 20)
+	{
+		fprintf(gen.out, "(");
+		gen_expr(depth - 1);
+		fprintf(gen.out, ")");
+	}
+	else if(choice < 30)
+	{
+		// Division and modulo always have a non-zero literal divisor.
+		fprintf(gen.out, "(");
+		gen_expr(depth - 1);
+		fprintf(gen.out, ") %s %d", rand_range(2) ? "/" : "%", 1 + rand_range(9));
+	}
+	else if(rand_range(2))
+	{
+		gen_leaf();
+		fprintf(gen.out, " %s ", operators[rand_range(16)]);
+		gen_expr(depth - 1);
+	}
+	else
+	{
+		gen_expr(depth - 1);
+		fprintf(gen.out, " %s ", operators[rand_range(16)]);
+		gen_leaf();
+	}
+}
+
+static void gen_function(int index, bool is_main)
+{
+	const gen_params_t* p = gen.params;
+	gen.function = index;
+
+	if(is_main)
+	{
+		fprintf(gen.out, "int main() {\n");
+	}
+	else
+	{
+		fprintf(gen.out, "int f%d() {\n", index);
+	}
+
+	// Every variable is declared and initialised before it can be used.
+	for(int i = 0; i < p->idents; i++)
+	{
+		fprintf(gen.out, "    int ");
+		gen_var(i);
+		fprintf(gen.out, " = %d;\n", rand_range(1000));
+	}
+
+	for(int i = 0; i < p->stmts; i++)
+	{
+		fprintf(gen.out, "    ");
+		gen_var(rand_range(p->idents));
+		fprintf(gen.out, " = ");
+		gen_expr(1 + rand_range(p->depth));
+		fprintf(gen.out, ";\n");
+	}
+
+	fprintf(gen.out, "    return ");
+	gen_expr(p->depth);
+	fprintf(gen.out, ";\n}\n");
+}
+
+static void generate_program(FILE* out, const gen_params_t* params)
+{
+	gen.out = out;
+	gen.params = params;
+	gen.rng = params->seed ? params->seed : 1;
+
+	for(int i = 0; i < params->functions; i++)
+	{
+		gen_function(i, i == params->functions - 1);
+	}
+}
+
+//
+// Harness.
+//
+
+typedef struct
+{
+	size_t bytes;
+	uint64_t tokens;
+	double lex_ms;
+	double parse_ms;
+	double generate_ms;
+	double total_ms;
+	long rss_kb;
+} measurement_t;
+
+static struct
+{
+	char foxc[PATH_MAX];
+	char dir[64];
+	char input[128];
+} harness;
+
+// Runs foxc over the generated input once, collecting its statistics.
+static bool run_foxc(measurement_t* m)
+{
+	int pipe_fds[2];
+	if(pipe(pipe_fds) < 0)
+	{
+		return false;
+	}
+
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		// foxc writes 'out.s' into its working directory.
+		if(chdir(harness.dir) < 0)
+		{
+			_exit(127);
+		}
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		dup2(pipe_fds[1], STDERR_FILENO);
+		close(pipe_fds[0]);
+		execl(harness.foxc, harness.foxc, "--stats", harness.input, (char*)NULL);
+		_exit(127);
+	}
+	close(pipe_fds[1]);
+
+	// The report is small, read it all before reaping the child.
+	char report[16 * 1024];
+	size_t used = 0;
+	ssize_t r;
+	while((r = read(pipe_fds[0], report + used, sizeof(report) - 1 - used)) > 0)
+	{
+		used += r;
+	}
+	report[used] = '\0';
+	close(pipe_fds[0]);
+
+	int status;
+	struct rusage usage;
+	if(wait4(pid, &status, 0, &usage) < 0 || !WIFEXITED(status) || WEXITSTATUS(status) != 0)
+	{
+		fprintf(stderr, "foxc failed:\n%s", report);
+		return false;
+	}
+	m->rss_kb = usage.ru_maxrss;
+
+	for(char* line = strtok(report, "\n"); line; line = strtok(NULL, "\n"))
+	{
+		char name[64];
+		double value;
+		unsigned long calls;
+		if(sscanf(line, "%63s %lu %lf", name, &calls, &value) == 3)
+		{
+			if(!strcmp(name, "lex"))      { m->lex_ms = value;      }
+			if(!strcmp(name, "parse"))    { m->parse_ms = value;    }
+			if(!strcmp(name, "generate")) { m->generate_ms = value; }
+		}
+		else if(sscanf(line, "%63s %lf", name, &value) == 2)
+		{
+			if(!strcmp(name, "total"))  { m->total_ms = value;         }
+			if(!strcmp(name, "tokens")) { m->tokens = (uint64_t)value; }
+		}
+	}
+	return true;
+}
+
+// Generates a program with the given parameters and measures compiling it,
+// keeping the fastest of several runs.
+static bool measure(const gen_params_t* params, measurement_t* best)
+{
+	FILE* f = fopen(harness.input, "w");
+	if(f == NULL)
+	{
+		return false;
+	}
+	generate_program(f, params);
+	fclose(f);
+
+	struct stat st;
+	stat(harness.input, &st);
+
+	for(int i = 0; i < REPEATS; i++)
+	{
+		measurement_t m = { 0 };
+		if(!run_foxc(&m))
+		{
+			return false;
+		}
+		m.bytes = st.st_size;
+
+		if(i == 0 || m.total_ms < best->total_ms)
+		{
+			*best = m;
+		}
+		if(i == 0 || m.rss_kb > best->rss_kb)
+		{
+			best->rss_kb = m.rss_kb;
+		}
+	}
+	return true;
+}
+
+static double throughput(size_t bytes, double ms)
+{
+	return ms > 0 ? (bytes / 1e6) / (ms / 1e3) : 0.0;
+}
+
+// Estimates the exponent k in time ~ size^k between two measurements.
+static double exponent(double t0, double t1, size_t s0, size_t s1)
+{
+	if(t0 <= 0 || t1 <= 0 || s1 <= s0)
+	{
+		return 0.0;
+	}
+	return log(t1 / t0) / log((double)s1 / s0);
+}
+
+static void print_exponent(const char* phase, double k, bool* flagged)
+{
+	bool super_linear = k > SUPER_LINEAR_THRESHOLD;
+	printf("  %-9s %5.2f%s\n", phase, k, super_linear ? "  <-- super-linear" : "");
+	*flagged |= super_linear;
+}
+
+// Doubles the parameters at the given offsets in gen_params_t 'steps' times,
+// measuring each size and reporting how each phase scales. The first
+// parameter is the one shown in the table.
+static bool sweep(const char* name, const size_t* offsets, int offset_count, int steps, bool* flagged)
+{
+	printf("\nsweep: %s\n", name);
+	printf("%10s %10s %10s %10s %10s %10s %10s\n",
+		name, "bytes", "tokens", "lex MB/s", "parse MB/s", "gen MB/s", "rss KB");
+
+	measurement_t first = { 0 };
+	measurement_t last = { 0 };
+
+	gen_params_t params = default_params;
+	for(int i = 0; i < steps; i++)
+	{
+		measurement_t m;
+		if(!measure(&params, &m))
+		{
+			return false;
+		}
+
+		int value = *(int*)((char*)&params + offsets[0]);
+		printf("%10d %10zu %10lu %10.1f %10.1f %10.1f %10ld\n",
+			value, m.bytes, (unsigned long)m.tokens,
+			throughput(m.bytes, m.lex_ms),
+			throughput(m.bytes, m.parse_ms),
+			throughput(m.bytes, m.generate_ms),
+			m.rss_kb);
+
+		if(i == 0)
+		{
+			first = m;
+		}
+		last = m;
+
+		for(int j = 0; j < offset_count; j++)
+		{
+			*(int*)((char*)&params + offsets[j]) *= 2;
+		}
+	}
+
+	printf("scaling exponent (time vs bytes):\n");
+	print_exponent("lex", exponent(first.lex_ms, last.lex_ms, first.bytes, last.bytes), flagged);
+	print_exponent("parse", exponent(first.parse_ms, last.parse_ms, first.bytes, last.bytes), flagged);
+	print_exponent("generate", exponent(first.generate_ms, last.generate_ms, first.bytes, last.bytes), flagged);
+	return true;
+}
+
+static int run(int argc, char** argv)
+{
+	const char* foxc = "bin/foxc";
+	int steps = 4;
+
+	for(int i = 0; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--foxc") && i + 1 < argc)
+		{
+			foxc = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--quick"))
+		{
+			steps = 2;
+		}
+		else
+		{
+			fprintf(stderr, "unknown option '%s'\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if(realpath(foxc, harness.foxc) == NULL)
+	{
+		fprintf(stderr, "unable to find foxc at '%s'\n", foxc);
+		return 1;
+	}
+
+	strcpy(harness.dir, "/tmp/foxc-bench-XXXXXX");
+	if(mkdtemp(harness.dir) == NULL)
+	{
+		fprintf(stderr, "unable to create a temporary directory\n");
+		return 1;
+	}
+	snprintf(harness.input, sizeof(harness.input), "%s/input.c", harness.dir);
+
+	static const size_t functions[] = { offsetof(gen_params_t, functions) };
+	static const size_t stmts[] = { offsetof(gen_params_t, stmts) };
+	static const size_t depth[] = { offsetof(gen_params_t, depth) };
+	static const size_t idents[] = { offsetof(gen_params_t, idents) };
+	// Growing the number of locals together with the number of statements
+	// that use them exposes lookups which are linear in the number of locals.
+	static const size_t locals[] = { offsetof(gen_params_t, idents), offsetof(gen_params_t, stmts) };
+
+	bool flagged = false;
+	bool ok = sweep("functions", functions, 1, steps, &flagged)
+	       && sweep("stmts", stmts, 1, steps, &flagged)
+	       && sweep("depth", depth, 1, steps, &flagged)
+	       && sweep("idents", idents, 1, steps, &flagged)
+	       && sweep("locals", locals, 2, steps, &flagged);
+
+	char path[128];
+	snprintf(path, sizeof(path), "%s/out.s", harness.dir);
+	unlink(path);
+	unlink(harness.input);
+	rmdir(harness.dir);
+
+	if(!ok)
+	{
+		return 1;
+	}
+	if(flagged)
+	{
+		printf("\nsuper-linear scaling detected\n");
+	}
+	return 0;
+}
+
+static int gen_main(int argc, char** argv)
+{
+	gen_params_t params = default_params;
+
+	for(int i = 0; i + 1 < argc; i += 2)
+	{
+		int value = atoi(argv[i + 1]);
+		if(!strcmp(argv[i], "--functions"))     { params.functions = value;   }
+		else if(!strcmp(argv[i], "--stmts"))    { params.stmts = value;       }
+		else if(!strcmp(argv[i], "--depth"))    { params.depth = value;       }
+		else if(!strcmp(argv[i], "--idents"))   { params.idents = value;      }
+		else if(!strcmp(argv[i], "--literals")) { params.literal_pct = value; }
+		else if(!strcmp(argv[i], "--seed"))     { params.seed = value;        }
+		else
+		{
+			fprintf(stderr, "unknown option '%s'\n", argv[i]);
+			return 1;
+		}
+	}
+
+	if(params.functions < 1 || params.idents < 1 || params.depth < 0 || params.stmts < 0)
+	{
+		fprintf(stderr, "invalid parameters\n");
+		return 1;
+	}
+
+	generate_program(stdout, &params);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	if(argc >= 2 && !strcmp(argv[1], "gen"))
+	{
+		return gen_main(argc - 2, argv + 2);
+	}
+	if(argc >= 2 && !strcmp(argv[1], "run"))
+	{
+		return run(argc - 2, argv + 2);
+	}
+
+	printf("usage: %s gen [--functions n] [--stmts n] [--depth n] [--idents n] [--literals pct] [--seed n]\n", argv[0]);
+	printf("       %s run [--foxc path] [--quick]\n", argv[0]);
+	return 1;
+}
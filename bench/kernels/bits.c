@@ -0,0 +1,326 @@
+int main() {
+    int x = 1234567;
+    int acc = 0;
+    int c = 0;
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    x = (x ^ (x << 7)) & 16777215;
+    x = x ^ (x >> 9);
+    c = x - ((x >> 1) & 1431655765);
+    c = (c & 858993459) + ((c >> 2) & 858993459);
+    c = (c + (c >> 4)) & 252645135;
+    c = (c + (c >> 8) + (c >> 16) + (c >> 24)) & 63;
+    acc = acc + c;
+    acc = acc ^ ((x >> 3) & 1);
+    return acc % 256;
+}
@@ -0,0 +1,206 @@
+int main() {
+    int n = 987654321;
+    int d = 7;
+    int r = 0;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    r = r + n % 10;
+    n = n / 10 + 98765432;
+    r = r + n / d % 3;
+    d = d % 5 + 3;
+    r = r - n % 7 / 2;
+    return r % 256;
+}
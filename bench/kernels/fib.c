@@ -0,0 +1,141 @@
+int main() {
+    int a = 0;
+    int b = 1;
+    int t = 0;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    t = a + b;
+    a = b;
+    b = t;
+    return b % 251;
+}
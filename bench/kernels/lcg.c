@@ -0,0 +1,245 @@
+int main() {
+    int s = 42;
+    int sum = 0;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    s = (s * 1103 + 12345) & 65535;
+    sum = (sum + s) & 1048575;
+    return sum % 256;
+}
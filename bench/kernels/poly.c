@@ -0,0 +1,186 @@
+int main() {
+    int x = 3;
+    int y = 0;
+    int k = 0;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    y = ((((x * 3 + 5) * x - 7) * x + 11) & 4095) - 2048;
+    k = k + (y < 0) + (y >= 100) * 2 + (y == x) - (x != 3);
+    x = (x + y + 4096) % 61 + 1;
+    return (k + x) & 255;
+}
@@ -0,0 +1,517 @@
+// Runtime benchmark for code generated by foxc.
+//
+//   runtime [--foxc path] [--runs n] [--baseline file] [--write-baseline file]
+//
+// Every program in tests/stage_*/valid and bench/kernels is compiled with
+// foxc, with 'gcc -O0' and with 'gcc -O2'. Each binary is run many times,
+// and the median wall time and the user-space instruction count are
+// reported. Both are net of the cost of starting an empty program. Programs
+// which foxc cannot compile yet are skipped. A program whose exit code
+// differs from gcc's is reported as a miscompile and makes the run fail.
+//
+// The kernels only use the subset of C that foxc supports, which has no
+// loops, branches or calls yet, so each one is a long unrolled block.
+//
+// '--write-baseline' records foxc's results in a tab separated file, and
+// '--baseline' compares against such a file. A program whose instruction
+// count grows by more than 2%, or whose median time grows by more than 25%
+// when instructions cannot be counted, is a regression and makes the run
+// fail. The baseline kept in bench/runtime_baseline.tsv must be written on a
+// machine with hardware performance counters, so a baseline is only written
+// when instructions can be counted. Comparing by time alone is noisy, and is
+// warned about whenever it happens.
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <limits.h>
+#include <glob.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define MAX_PROGRAMS 256
+
+// Allowed growth before a result counts as a regression.
+#define INSN_TOLERANCE 1.02
+#define TIME_TOLERANCE 1.25
+
+// Time differences below this are indistinguishable from noise.
+#define TIME_NOISE_MS 0.5
+
+// The toolchains each program is built with.
+typedef enum
+{
+	TOOL_FOXC,
+	TOOL_GCC_O0,
+	TOOL_GCC_O2,
+	TOOL_COUNT
+} tool_t;
+
+static const char* tool_binaries[TOOL_COUNT] = { "foxc.bin", "O0.bin", "O2.bin" };
+
+typedef struct
+{
+	double median_ms;
+	// Minimum over all runs, or -1 if instructions cannot be counted.
+	long long insns;
+	int exit_code;
+} result_t;
+
+static struct
+{
+	char foxc[PATH_MAX];
+	char dir[64];
+	int runs;
+
+	// Cost of starting a program which does nothing.
+	result_t empty;
+} state;
+
+static double now_ms()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+// Runs a command in the scratch directory with its output discarded,
+// returning its exit code or -1 if it could not be run.
+static int run_command(char* const argv[])
+{
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		dup2(null_fd, STDERR_FILENO);
+		if(chdir(state.dir) < 0)
+		{
+			_exit(127);
+		}
+		execvp(argv[0], argv);
+		_exit(127);
+	}
+
+	int status;
+	if(pid < 0 || waitpid(pid, &status, 0) < 0 || !WIFEXITED(status))
+	{
+		return -1;
+	}
+	return WEXITSTATUS(status);
+}
+
+// Opens a counter of user-space instructions retired by the given process,
+// which starts counting when the process calls exec.
+static int open_insn_counter(pid_t pid)
+{
+	struct perf_event_attr attr;
+	memset(&attr, 0, sizeof(attr));
+	attr.type = PERF_TYPE_HARDWARE;
+	attr.size = sizeof(attr);
+	attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+	attr.disabled = 1;
+	attr.enable_on_exec = 1;
+	attr.exclude_kernel = 1;
+	attr.exclude_hv = 1;
+	return syscall(SYS_perf_event_open, &attr, pid, -1, -1, 0);
+}
+
+static int compare_doubles(const void* a, const void* b)
+{
+	double x = *(const double*)a;
+	double y = *(const double*)b;
+	return (x > y) - (x < y);
+}
+
+// Runs the given binary from the scratch directory many times.
+static bool measure(const char* binary, result_t* result)
+{
+	char path[128];
+	snprintf(path, sizeof(path), "%s/%s", state.dir, binary);
+
+	double* times = malloc(state.runs * sizeof(double));
+	result->insns = -1;
+
+	for(int i = 0; i < state.runs; i++)
+	{
+		// The child waits on a pipe until the counter is attached.
+		int go[2];
+		if(pipe(go) < 0)
+		{
+			free(times);
+			return false;
+		}
+
+		pid_t pid = fork();
+		if(pid == 0)
+		{
+			char c;
+			close(go[1]);
+			if(read(go[0], &c, 1) < 0)
+			{
+				_exit(127);
+			}
+			execl(path, path, (char*)NULL);
+			_exit(127);
+		}
+		close(go[0]);
+
+		int counter = open_insn_counter(pid);
+
+		double start = now_ms();
+		if(write(go[1], "x", 1) < 0)
+		{
+			close(go[1]);
+			free(times);
+			return false;
+		}
+		close(go[1]);
+
+		int status;
+		waitpid(pid, &status, 0);
+		times[i] = now_ms() - start;
+		result->exit_code = WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+
+		long long count;
+		if(counter >= 0 && read(counter, &count, sizeof(count)) == sizeof(count))
+		{
+			if(result->insns < 0 || count < result->insns)
+			{
+				result->insns = count;
+			}
+		}
+		if(counter >= 0)
+		{
+			close(counter);
+		}
+	}
+
+	qsort(times, state.runs, sizeof(double), compare_doubles);
+	result->median_ms = times[state.runs / 2];
+	free(times);
+	return true;
+}
+
+// Builds the given source with every toolchain into the scratch directory.
+// Returns false if foxc cannot compile it.
+static bool build(const char* source, bool* built)
+{
+	char foxc_out[128];
+	snprintf(foxc_out, sizeof(foxc_out), "%s/out.s", state.dir);
+	unlink(foxc_out);
+
+	char* foxc[] = { state.foxc, (char*)source, NULL };
+	char* assemble[] = { "gcc", "-o", "foxc.bin", "out.s", NULL };
+	char* gcc_o0[] = { "gcc", "-O0", "-w", "-o", "O0.bin", (char*)source, NULL };
+	char* gcc_o2[] = { "gcc", "-O2", "-w", "-o", "O2.bin", (char*)source, NULL };
+
+	built[TOOL_FOXC] = run_command(foxc) == 0 && run_command(assemble) == 0;
+	built[TOOL_GCC_O0] = run_command(gcc_o0) == 0;
+	built[TOOL_GCC_O2] = run_command(gcc_o2) == 0;
+	return built[TOOL_FOXC];
+}
+
+// Removes the cost of starting an empty program from a result.
+static void subtract_empty(result_t* r)
+{
+	r->median_ms -= state.empty.median_ms;
+	if(r->median_ms < 0)
+	{
+		r->median_ms = 0;
+	}
+
+	if(r->insns >= 0 && state.empty.insns >= 0)
+	{
+		r->insns -= state.empty.insns;
+		if(r->insns < 0)
+		{
+			r->insns = 0;
+		}
+	}
+}
+
+// Absolute paths are used throughout since builds run in the scratch directory.
+static int collect_programs(char** programs)
+{
+	static const char* patterns[] = { "tests/stage_*/valid/*.c", "bench/kernels/*.c" };
+	int count = 0;
+
+	for(int p = 0; p < 2; p++)
+	{
+		glob_t g;
+		if(glob(patterns[p], 0, NULL, &g) != 0)
+		{
+			continue;
+		}
+		for(size_t i = 0; i < g.gl_pathc && count < MAX_PROGRAMS; i++)
+		{
+			programs[count++] = realpath(g.gl_pathv[i], NULL);
+		}
+		globfree(&g);
+	}
+	return count;
+}
+
+// Returns a short name for a program, such as 'stage_3/valid/add.c'.
+static const char* short_name(const char* path)
+{
+	const char* name = strstr(path, "tests/");
+	if(name)
+	{
+		return name + strlen("tests/");
+	}
+	name = strstr(path, "bench/");
+	return name ? name + strlen("bench/") : path;
+}
+
+typedef struct
+{
+	char name[128];
+	double median_ms;
+	long long insns;
+} baseline_entry_t;
+
+static int read_baseline(const char* path, baseline_entry_t* entries)
+{
+	FILE* f = fopen(path, "r");
+	if(f == NULL)
+	{
+		return -1;
+	}
+
+	int count = 0;
+	char line[512];
+	while(count < MAX_PROGRAMS && fgets(line, sizeof(line), f))
+	{
+		baseline_entry_t* e = &entries[count];
+		if(line[0] != '#' && sscanf(line, "%127s %lld %lf", e->name, &e->insns, &e->median_ms) == 3)
+		{
+			count++;
+		}
+	}
+	fclose(f);
+	return count;
+}
+
+static void print_insns(long long insns)
+{
+	if(insns < 0)
+	{
+		printf(" %10s", "-");
+	}
+	else
+	{
+		printf(" %10lld", insns);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* foxc = "bin/foxc";
+	const char* baseline_path = NULL;
+	const char* write_path = NULL;
+	state.runs = 21;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--foxc") && i + 1 < argc)
+		{
+			foxc = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--runs") && i + 1 < argc)
+		{
+			state.runs = atoi(argv[++i]);
+		}
+		else if(!strcmp(argv[i], "--baseline") && i + 1 < argc)
+		{
+			baseline_path = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--write-baseline") && i + 1 < argc)
+		{
+			write_path = argv[++i];
+		}
+		else
+		{
+			printf("usage: %s [--foxc path] [--runs n] [--baseline file] [--write-baseline file]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(state.runs < 1 || realpath(foxc, state.foxc) == NULL)
+	{
+		fprintf(stderr, "unable to find foxc at '%s'\n", foxc);
+		return 1;
+	}
+
+	strcpy(state.dir, "/tmp/foxc-runtime-XXXXXX");
+	if(mkdtemp(state.dir) == NULL)
+	{
+		fprintf(stderr, "unable to create a temporary directory\n");
+		return 1;
+	}
+
+	// Measure the cost of starting a program, to subtract from every result.
+	char empty_path[128];
+	snprintf(empty_path, sizeof(empty_path), "%s/empty.c", state.dir);
+	FILE* f = fopen(empty_path, "w");
+	fprintf(f, "int main() { return 0; }\n");
+	fclose(f);
+
+	bool built[TOOL_COUNT];
+	if(!build(empty_path, built) || !built[TOOL_GCC_O0] || !measure(tool_binaries[TOOL_GCC_O0], &state.empty))
+	{
+		fprintf(stderr, "unable to build an empty program\n");
+		return 1;
+	}
+	bool counted = state.empty.insns >= 0;
+	if(!counted)
+	{
+		fprintf(stderr, "WARNING: instruction counters are unavailable, regressions can only be judged by wall-clock time\n");
+	}
+	if(write_path && !counted)
+	{
+		fprintf(stderr, "refusing to write baseline '%s' without instruction counts\n", write_path);
+		return 1;
+	}
+
+	baseline_entry_t* baseline = calloc(MAX_PROGRAMS, sizeof(baseline_entry_t));
+	int baseline_count = baseline_path ? read_baseline(baseline_path, baseline) : 0;
+	if(baseline_count < 0)
+	{
+		fprintf(stderr, "unable to read baseline '%s'\n", baseline_path);
+		return 1;
+	}
+	if(baseline_path == NULL)
+	{
+		fprintf(stderr, "WARNING: no baseline given, regressions are not checked\n");
+	}
+	for(int b = 0; b < baseline_count; b++)
+	{
+		if(baseline[b].insns < 0)
+		{
+			fprintf(stderr, "WARNING: baseline '%s' has no instruction counts, regenerate it on a machine with performance counters\n", baseline_path);
+			break;
+		}
+	}
+
+	FILE* out = NULL;
+	if(write_path)
+	{
+		out = fopen(write_path, "w");
+		if(out == NULL)
+		{
+			fprintf(stderr, "unable to write baseline '%s'\n", write_path);
+			return 1;
+		}
+		fprintf(out, "# program\tfoxc_insns\tfoxc_median_ms\n");
+	}
+
+	char* programs[MAX_PROGRAMS];
+	int program_count = collect_programs(programs);
+
+	printf("%-36s %4s %9s %9s %9s %10s %10s %10s\n",
+		"program", "exit", "foxc ms", "-O0 ms", "-O2 ms", "foxc insn", "-O0 insn", "-O2 insn");
+
+	int skipped = 0;
+	int miscompiles = 0;
+	int regressions = 0;
+	int timed_comparisons = 0;
+
+	for(int i = 0; i < program_count; i++)
+	{
+		const char* name = short_name(programs[i]);
+
+		if(!build(programs[i], built) || !built[TOOL_GCC_O0] || !built[TOOL_GCC_O2])
+		{
+			skipped++;
+			continue;
+		}
+
+		result_t results[TOOL_COUNT];
+		bool ok = true;
+		for(int t = 0; t < TOOL_COUNT; t++)
+		{
+			ok = ok && measure(tool_binaries[t], &results[t]);
+			subtract_empty(&results[t]);
+		}
+		if(!ok)
+		{
+			skipped++;
+			continue;
+		}
+
+		printf("%-36s %4d %9.4f %9.4f %9.4f", name, results[TOOL_FOXC].exit_code,
+			results[TOOL_FOXC].median_ms, results[TOOL_GCC_O0].median_ms, results[TOOL_GCC_O2].median_ms);
+		for(int t = 0; t < TOOL_COUNT; t++)
+		{
+			print_insns(results[t].insns);
+		}
+
+		if(results[TOOL_FOXC].exit_code != results[TOOL_GCC_O0].exit_code)
+		{
+			printf("  MISCOMPILE (gcc: %d)", results[TOOL_GCC_O0].exit_code);
+			miscompiles++;
+		}
+
+		for(int b = 0; b < baseline_count; b++)
+		{
+			if(strcmp(baseline[b].name, name))
+			{
+				continue;
+			}
+
+			bool by_insns = results[TOOL_FOXC].insns >= 0 && baseline[b].insns >= 0;
+			timed_comparisons += !by_insns;
+			bool regressed = by_insns
+				? results[TOOL_FOXC].insns > baseline[b].insns * INSN_TOLERANCE
+				: results[TOOL_FOXC].median_ms > baseline[b].median_ms * TIME_TOLERANCE
+					&& results[TOOL_FOXC].median_ms - baseline[b].median_ms > TIME_NOISE_MS;
+			if(regressed)
+			{
+				printf("  REGRESSION");
+				regressions++;
+			}
+		}
+		printf("\n");
+
+		if(out)
+		{
+			fprintf(out, "%s\t%lld\t%.6f\n", name, results[TOOL_FOXC].insns, results[TOOL_FOXC].median_ms);
+		}
+	}
+
+	if(out)
+	{
+		fclose(out);
+	}
+
+	printf("\n%d programs, %d skipped (unsupported), %d miscompiled, %d regressed\n",
+		program_count, skipped, miscompiles, regressions);
+	if(timed_comparisons > 0)
+	{
+		fprintf(stderr, "WARNING: %d programs were compared with the baseline by wall-clock time only\n", timed_comparisons);
+	}
+
+	for(int t = 0; t < TOOL_COUNT; t++)
+	{
+		char path[128];
+		snprintf(path, sizeof(path), "%s/%s", state.dir, tool_binaries[t]);
+		unlink(path);
+	}
+	char path[128];
+	snprintf(path, sizeof(path), "%s/out.s", state.dir);
+	unlink(path);
+	unlink(empty_path);
+	rmdir(state.dir);
+
+	return miscompiles || regressions ? 1 : 0;
+}
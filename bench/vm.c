@@ -0,0 +1,204 @@
+// Bytecode interpreter benchmark.
+//
+//   vm [--foxc path] [--calls n]
+//
+// Every program in tests/stage_*/valid and bench/kernels is run in memory by
+// foxc, once as machine code ('--run') and once with the bytecode
+// interpreter ('--run --vm'). Each run calls 'main' many times, and the time
+// spent running, taken from the 'run' phase of 'foxc -ftime-report', is
+// reported per call along with the interpreter's slowdown. Programs which
+// foxc cannot compile are skipped, and a program whose result differs
+// between the two is reported as a mismatch.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include <limits.h>
+#include <glob.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#define MAX_PROGRAMS 256
+
+typedef struct
+{
+	double run_ms;
+	int exit_code;
+} result_t;
+
+static struct
+{
+	char foxc[PATH_MAX];
+	char calls[16];
+} state;
+
+// Runs the program through foxc, with the interpreter if 'vm' is set.
+// Returns false if foxc did not get as far as running it.
+static bool run(const char* program, bool vm, result_t* result)
+{
+	int pipe_fds[2];
+	if(pipe(pipe_fds) < 0)
+	{
+		return false;
+	}
+
+	pid_t pid = fork();
+	if(pid == 0)
+	{
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		dup2(pipe_fds[1], STDERR_FILENO);
+		close(pipe_fds[0]);
+		if(vm)
+		{
+			execl(state.foxc, state.foxc, "-ftime-report", "--run", "--vm", "--calls", state.calls, program, (char*)NULL);
+		}
+		else
+		{
+			execl(state.foxc, state.foxc, "-ftime-report", "--run", "--calls", state.calls, program, (char*)NULL);
+		}
+		_exit(127);
+	}
+	close(pipe_fds[1]);
+
+	// The report is small, read it all before reaping the child.
+	char report[4096];
+	size_t used = 0;
+	ssize_t r;
+	while((r = read(pipe_fds[0], report + used, sizeof(report) - 1 - used)) > 0)
+	{
+		used += r;
+	}
+	report[used] = '\0';
+	close(pipe_fds[0]);
+
+	int status;
+	if(waitpid(pid, &status, 0) < 0 || !WIFEXITED(status))
+	{
+		return false;
+	}
+	result->exit_code = WEXITSTATUS(status);
+
+	// The report is only printed once the program has run.
+	for(char* line = strtok(report, "\n"); line; line = strtok(NULL, "\n"))
+	{
+		char name[64];
+		unsigned long calls;
+		double value;
+		if(sscanf(line, "%63s %lu %lf", name, &calls, &value) == 3 && !strcmp(name, "run") && calls > 0)
+		{
+			result->run_ms = value;
+			return true;
+		}
+	}
+	return false;
+}
+
+static int collect_programs(char** programs)
+{
+	static const char* patterns[] = { "tests/stage_*/valid/*.c", "bench/kernels/*.c" };
+	int count = 0;
+
+	for(int p = 0; p < 2; p++)
+	{
+		glob_t g;
+		if(glob(patterns[p], 0, NULL, &g) != 0)
+		{
+			continue;
+		}
+		for(size_t i = 0; i < g.gl_pathc && count < MAX_PROGRAMS; i++)
+		{
+			programs[count++] = strdup(g.gl_pathv[i]);
+		}
+		globfree(&g);
+	}
+	return count;
+}
+
+int main(int argc, char** argv)
+{
+	const char* foxc = "bin/foxc";
+	int calls = 10000;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--foxc") && i + 1 < argc)
+		{
+			foxc = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--calls") && i + 1 < argc)
+		{
+			calls = atoi(argv[++i]);
+		}
+		else
+		{
+			printf("usage: %s [--foxc path] [--calls n]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	if(calls < 1 || realpath(foxc, state.foxc) == NULL)
+	{
+		fprintf(stderr, "unable to find foxc at '%s'\n", foxc);
+		return 1;
+	}
+	snprintf(state.calls, sizeof(state.calls), "%d", calls);
+
+	char* programs[MAX_PROGRAMS];
+	int program_count = collect_programs(programs);
+
+	printf("%-36s %4s %12s %12s %9s\n", "program", "exit", "native us", "vm us", "slowdown");
+
+	int skipped = 0;
+	int mismatches = 0;
+	int measured = 0;
+	double log_slowdown = 0;
+
+	for(int i = 0; i < program_count; i++)
+	{
+		const char* name = strstr(programs[i], "stage_") ? strstr(programs[i], "stage_") : programs[i];
+
+		result_t native;
+		result_t vm;
+		if(!run(programs[i], false, &native) || !run(programs[i], true, &vm))
+		{
+			skipped++;
+			free(programs[i]);
+			continue;
+		}
+
+		double native_us = native.run_ms * 1e3 / calls;
+		double vm_us = vm.run_ms * 1e3 / calls;
+		printf("%-36s %4d %12.4f %12.4f", name, vm.exit_code, native_us, vm_us);
+
+		if(native_us > 0)
+		{
+			printf(" %8.1fx", vm_us / native_us);
+			log_slowdown += log(vm_us / native_us);
+			measured++;
+		}
+		else
+		{
+			printf(" %9s", "-");
+		}
+
+		if(native.exit_code != vm.exit_code)
+		{
+			printf("  MISMATCH (native: %d)", native.exit_code);
+			mismatches++;
+		}
+		printf("\n");
+		free(programs[i]);
+	}
+
+	printf("\n%d programs, %d skipped (unsupported), %d mismatched", program_count, skipped, mismatches);
+	if(measured > 0)
+	{
+		printf(", interpreter %.1fx slower on average (geometric mean)", exp(log_slowdown / measured));
+	}
+	printf("\n");
+	return 0;
+}
@@ -0,0 +1,92 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "arena.h"
+#include "error.h"
+
+// Finds room for 'size' bytes aligned to 'align', returning the block to
+// allocate from with its 'used' offset already aligned.
+static arena_block_t* reserve(arena_t* arena, size_t size, size_t align)
+{
+	arena_block_t* head = arena->head;
+	if(head)
+	{
+		size_t start = (head->used + align - 1) & ~(align - 1);
+		if(start + size <= head->size)
+		{
+			head->used = start;
+			return head;
+		}
+	}
+
+	size_t block_size = size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE;
+	arena_block_t* block = malloc(sizeof(arena_block_t) + block_size);
+	if(block == NULL)
+	{
+		error("out of memory\n");
+	}
+	block->size = block_size;
+	block->used = 0;
+
+	if(head && block_size > ARENA_BLOCK_SIZE)
+	{
+		// Oversized blocks are only ever used for a single allocation, so link
+		// them in behind the head and keep bumping through the head's free space.
+		block->next = head->next;
+		head->next = block;
+	}
+	else
+	{
+		block->next = head;
+		arena->head = block;
+	}
+	return block;
+}
+
+void* arena_alloc(arena_t* arena, size_t size)
+{
+	arena_block_t* block = reserve(arena, size, alignof(max_align_t));
+	void* ptr = block->data + block->used;
+	block->used += size;
+
+	memset(ptr, 0, size);
+	return ptr;
+}
+
+char* arena_alloc_bytes(arena_t* arena, size_t size)
+{
+	arena_block_t* block = reserve(arena, size, 1);
+	char* ptr = block->data + block->used;
+	block->used += size;
+	return ptr;
+}
+
+void arena_release(arena_t* arena)
+{
+	arena_block_t* block = arena->head;
+	while(block)
+	{
+		arena_block_t* next = block->next;
+		free(block);
+		block = next;
+	}
+	arena->head = NULL;
+}
+
+void arena_reset(arena_t* arena)
+{
+	arena_block_t* head = arena->head;
+	if(head == NULL || head->size != ARENA_BLOCK_SIZE)
+	{
+		arena_release(arena);
+		return;
+	}
+
+	// Oversized blocks are always linked behind the head.
+	arena_block_t* rest = head->next;
+	head->next = NULL;
+	head->used = 0;
+
+	arena_t tail = { rest };
+	arena_release(&tail);
+}
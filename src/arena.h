@@ -0,0 +1,42 @@
+#ifndef _ARENA_H
+#define _ARENA_H
+
+#include <stddef.h>
+#include <stdalign.h>
+
+// Size of a regular arena block. Requests larger than this get a block of
+// their own.
+#define ARENA_BLOCK_SIZE (64 * 1024)
+
+typedef struct arena_block_t
+{
+	struct arena_block_t* next;
+	size_t size;
+	size_t used;
+	alignas(max_align_t) char data[];
+} arena_block_t;
+
+// A region allocator. Memory is handed out by bumping a pointer through a
+// list of large blocks, and is only ever released all at once.
+// A zero-initialised arena_t is a valid, empty arena.
+typedef struct
+{
+	arena_block_t* head;
+} arena_t;
+
+// Allocates 'size' zeroed bytes from the arena, suitably aligned for any type.
+void* arena_alloc(arena_t* arena, size_t size);
+
+// Allocates 'size' uninitialised bytes from the arena with no alignment
+// guarantees, intended for packing character data.
+char* arena_alloc_bytes(arena_t* arena, size_t size);
+
+// Releases every allocation made from the arena. The arena may be reused
+// afterwards.
+void arena_release(arena_t* arena);
+
+// Releases every allocation made from the arena, but keeps one regular block
+// to serve the next allocations from, rather than returning it to malloc.
+void arena_reset(arena_t* arena);
+
+#endif
@@ -1,10 +1,47 @@
 #include "ast_printer.h"
 
-static struct
+static _Thread_local struct
 {
 	FILE* handle;
 } state;
 
+static void print_unary_operator(unary_operator_t operator)
+{
+	switch(operator)
+	{
+	case UNARY_NEGATE:             { fprintf(state.handle, "-"); break; }
+	case UNARY_BITWISE_COMPLEMENT: { fprintf(state.handle, "~"); break; }
+	case UNARY_LOGICAL_NEGATE:     { fprintf(state.handle, "!"); break; }
+	default: UNHANDLED_CASE();
+	}
+}
+
+static void print_binary_operator(binary_operator_t operator)
+{
+	switch(operator)
+	{
+	case BINARY_ADD:         { fprintf(state.handle, "+" ); break; }
+	case BINARY_SUB:         { fprintf(state.handle, "-" ); break; }
+	case BINARY_MUL:         { fprintf(state.handle, "*" ); break; }
+	case BINARY_DIV:         { fprintf(state.handle, "/" ); break; }
+	case BINARY_LESS:        { fprintf(state.handle, "<" ); break; }
+	case BINARY_LESS_EQ:     { fprintf(state.handle, "<="); break; }
+	case BINARY_GRTR:        { fprintf(state.handle, ">" ); break; }
+	case BINARY_GRTR_EQ:     { fprintf(state.handle, ">="); break; }
+	case BINARY_EQUALS:      { fprintf(state.handle, "=="); break; }
+	case BINARY_NOT_EQ:      { fprintf(state.handle, "!="); break; }
+	case BINARY_LOGICAL_AND: { fprintf(state.handle, "&&"); break; }
+	case BINARY_LOGICAL_OR:  { fprintf(state.handle, "||"); break; }
+	case BINARY_MODULO:      { fprintf(state.handle, "%%"); break; }
+	case BINARY_BITWISE_AND: { fprintf(state.handle, "&" ); break; }
+	case BINARY_BITWISE_OR:  { fprintf(state.handle, "|" ); break; }
+	case BINARY_BITWISE_XOR: { fprintf(state.handle, "^" ); break; }
+	case BINARY_SHIFT_LEFT:  { fprintf(state.handle, "<<"); break; }
+	case BINARY_SHIFT_RIGHT: { fprintf(state.handle, ">>"); break; }
+	default: UNHANDLED_CASE();
+	}
+}
+
 static void print_expr(expr_t* expr)
 {
 	switch(expr->type)
@@ -13,14 +50,7 @@ static void print_expr(expr_t* expr)
 		fprintf(state.handle, "%ld", expr->value);
 	} break;
 	case EXPR_UNARY: {
-		switch(expr->unary_operator)
-		{
-		case UNARY_NEGATE:             { fprintf(state.handle, "-"); break; }
-		case UNARY_BITWISE_COMPLEMENT: { fprintf(state.handle, "~"); break; }
-		case UNARY_LOGICAL_NEGATE:     { fprintf(state.handle, "!"); break; }
-		default: UNHANDLED_CASE();
-		};
-
+		print_unary_operator(expr->unary_operator);
 		print_expr(expr->unary_operand);
 	} break;
 	case EXPR_BINARY: {
@@ -28,28 +58,7 @@ static void print_expr(expr_t* expr)
 		print_expr(expr->binary_lhs);
 		fprintf(state.handle, " ");
 
-		switch(expr->binary_operator)
-		{
-		case BINARY_ADD:         { fprintf(state.handle, "+" ); break; }
-		case BINARY_SUB:         { fprintf(state.handle, "-" ); break; }
-		case BINARY_MUL:         { fprintf(state.handle, "*" ); break; }
-		case BINARY_DIV:         { fprintf(state.handle, "/" ); break; }
-		case BINARY_LESS:        { fprintf(state.handle, "<" ); break; }
-		case BINARY_LESS_EQ:     { fprintf(state.handle, "<="); break; }
-		case BINARY_GRTR:        { fprintf(state.handle, ">" ); break; }
-		case BINARY_GRTR_EQ:     { fprintf(state.handle, ">="); break; }
-		case BINARY_EQUALS:      { fprintf(state.handle, "=="); break; }
-		case BINARY_NOT_EQ:      { fprintf(state.handle, "!="); break; }
-		case BINARY_LOGICAL_AND: { fprintf(state.handle, "&&"); break; }
-		case BINARY_LOGICAL_OR:  { fprintf(state.handle, "||"); break; }
-		case BINARY_MODULO:      { fprintf(state.handle, "%%"); break; }
-		case BINARY_BITWISE_AND: { fprintf(state.handle, "&" ); break; }
-		case BINARY_BITWISE_OR:  { fprintf(state.handle, "|" ); break; }
-		case BINARY_BITWISE_XOR: { fprintf(state.handle, "^" ); break; }
-		case BINARY_SHIFT_LEFT:  { fprintf(state.handle, "<<"); break; }
-		case BINARY_SHIFT_RIGHT: { fprintf(state.handle, ">>"); break; }
-		default: UNHANDLED_CASE();
-		}
+		print_binary_operator(expr->binary_operator);
 
 		fprintf(state.handle, " ");
 		print_expr(expr->binary_rhs);
@@ -103,7 +112,7 @@ static void print_decl(decl_t* decl)
 	{
 	case DECL_FUNC: {
 		fprintf(state.handle, "int %s () {\n", decl->name);
-		for(int i = 0; i < sb_count(decl->stmts); i++)
+		for(int i = 0; i < decl->stmt_count; i++)
 		{
 			print_stmt(decl->stmts[i]);
 		}
@@ -117,7 +126,92 @@ static void print_decl(decl_t* decl)
 
 static void print_program(program_t* program)
 {
-	print_decl(program->decl);
+	for(int i = 0; i < program->decl_count; i++)
+	{
+		print_decl(program->decls[i]);
+	}
+}
+
+static void print_flat_expr(const flat_ast_t* ast, flat_id_t expr)
+{
+	switch(flat_expr_type(ast, expr))
+	{
+	case EXPR_LITERAL: {
+		fprintf(state.handle, "%ld", flat_literal_value(ast, expr));
+	} break;
+	case EXPR_UNARY: {
+		print_unary_operator(flat_unary_operator(ast, expr));
+		print_flat_expr(ast, flat_unary_operand(ast, expr));
+	} break;
+	case EXPR_BINARY: {
+		fprintf(state.handle, "(");
+		print_flat_expr(ast, flat_binary_lhs(ast, expr));
+		fprintf(state.handle, " ");
+
+		print_binary_operator(flat_binary_operator(ast, expr));
+
+		fprintf(state.handle, " ");
+		print_flat_expr(ast, flat_binary_rhs(ast, expr));
+		fprintf(state.handle, ")");
+	} break;
+	case EXPR_ASSIGNMENT: {
+		fprintf(state.handle, "(%s = ", flat_assign_name(ast, expr));
+		print_flat_expr(ast, flat_assign_rhs(ast, expr));
+		fprintf(state.handle, ")");
+	} break;
+	case EXPR_VAR: {
+		fprintf(state.handle, "%s", flat_var_name(ast, expr));
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+static void print_flat_stmt(const flat_ast_t* ast, flat_id_t stmt)
+{
+	switch(flat_stmt_type(ast, stmt))
+	{
+	case STMT_EXPR: {
+		print_flat_expr(ast, flat_stmt_expr(ast, stmt));
+		fprintf(state.handle, ";\n");
+	} break;
+	case STMT_RETURN: {
+		fprintf(state.handle, "return ");
+		print_flat_expr(ast, flat_stmt_expr(ast, stmt));
+		fprintf(state.handle, ";\n");
+	} break;
+	case STMT_DECLARE: {
+		fprintf(state.handle, "int %s", flat_declare_name(ast, stmt));
+		if(flat_stmt_expr(ast, stmt) != FLAT_NONE)
+		{
+			fprintf(state.handle, " = ");
+			print_flat_expr(ast, flat_stmt_expr(ast, stmt));
+		}
+		fprintf(state.handle, ";\n");
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+static void print_flat_decl(const flat_ast_t* ast, flat_id_t decl)
+{
+	switch(flat_decl_type(ast, decl))
+	{
+	case DECL_FUNC: {
+		fprintf(state.handle, "int %s () {\n", flat_decl_name(ast, decl));
+		for(int i = 0; i < flat_decl_stmt_count(ast, decl); i++)
+		{
+			print_flat_stmt(ast, flat_decl_stmt(ast, decl, i));
+		}
+		fprintf(state.handle, "}\n");
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
 }
 
 void print_ast(FILE* handle, program_t* program)
@@ -128,6 +222,25 @@ void print_ast(FILE* handle, program_t* program)
 	fprintf(state.handle, "\n");
 }
 
+void print_flat_ast(FILE* handle, const flat_ast_t* ast)
+{
+	state.handle = handle;
+
+	for(int i = 0; i < flat_decl_count(ast); i++)
+	{
+		print_flat_decl(ast, i);
+	}
+	fprintf(state.handle, "\n");
+}
+
+void print_declaration(FILE* handle, decl_t* declaration)
+{
+	state.handle = handle;
+
+	print_decl(declaration);
+	fprintf(state.handle, "\n");
+}
+
 void print_expression(FILE* handle, expr_t* expression)
 {
 	state.handle = handle;
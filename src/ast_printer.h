@@ -4,11 +4,19 @@
 #include <stdio.h>
 
 #include "parser.h"
+#include "flat_ast.h"
 #include "error.h"
 
 // Prints the given AST to the given file handle.
 void print_ast(FILE* handle, program_t* program);
 
+// Prints the given flat AST to the given file handle, the output is the same
+// as that of 'print_ast()' for the program it was built from.
+void print_flat_ast(FILE* handle, const flat_ast_t* ast);
+
+// Prints a single declaration.
+void print_declaration(FILE* handle, decl_t* declaration);
+
 // Prints a single expression.
 void print_expression(FILE* handle, expr_t* expression);
 
@@ -0,0 +1,412 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "cache.h"
+#include "buf.h"
+
+// Identifies an index file, and the layout of the cache.
+#define CACHE_MAGIC 0x58444943 // "CIDX"
+#define CACHE_VERSION 1
+
+// Initial number of slots in the index, must be a power of two.
+#define CACHE_MIN_CAPACITY 256
+
+typedef struct
+{
+	uint32_t magic;
+	uint32_t version;
+	uint32_t capacity;
+	uint32_t count;
+} index_header_t;
+
+// A slot in the index, a key of zero marks an empty slot.
+typedef struct
+{
+	uint64_t key;
+	uint64_t offset;
+} index_slot_t;
+
+// Header of a record in the data file. It is followed by the label
+// references, and then by the text padded to a multiple of eight bytes.
+typedef struct
+{
+	uint32_t text_length;
+	uint32_t label_ref_count;
+	uint32_t label_count;
+	uint32_t reserved;
+} record_header_t;
+
+// A function added since the cache was opened, its record is held in
+// 'pending_data' at 'offset'.
+typedef struct
+{
+	uint64_t key;
+	size_t offset;
+} pending_t;
+
+struct code_cache
+{
+	char* dir;
+	char* index_path;
+	char* data_path;
+
+	// The files as they were when the cache was opened, either may be NULL
+	// if it did not exist or was not valid.
+	const index_header_t* index;
+	size_t index_size;
+	const char* data;
+	size_t data_size;
+
+	pthread_mutex_t lock;
+	pending_t* pending;
+	char* pending_data;
+};
+
+// Keys are never zero, as that marks an empty slot.
+static uint64_t slot_key(uint64_t key)
+{
+	return key ? key : 1;
+}
+
+static size_t record_size(const record_header_t* header)
+{
+	size_t size = sizeof(record_header_t) + header->label_ref_count * sizeof(emit_label_ref_t) + header->text_length;
+	return (size + 7) & ~(size_t)7;
+}
+
+// Returns the slot holding 'key' in the given table, or the empty slot it
+// would be inserted into.
+static index_slot_t* find_slot(index_slot_t* slots, uint32_t capacity, uint64_t key)
+{
+	uint32_t mask = capacity - 1;
+	uint32_t i = (uint32_t)(key ^ (key >> 32)) & mask;
+	while(slots[i].key && slots[i].key != key)
+	{
+		i = (i + 1) & mask;
+	}
+	return &slots[i];
+}
+
+// Maps the whole of the given file read-only, returning NULL if it does not
+// exist or is empty.
+static const void* map_whole_file(const char* path, size_t* size)
+{
+	int fd = open(path, O_RDONLY);
+	if(fd < 0)
+	{
+		return NULL;
+	}
+
+	struct stat st;
+	void* contents = MAP_FAILED;
+	if(fstat(fd, &st) == 0 && st.st_size > 0)
+	{
+		contents = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+	}
+	close(fd);
+
+	if(contents == MAP_FAILED)
+	{
+		return NULL;
+	}
+	*size = st.st_size;
+	return contents;
+}
+
+// Returns true if the mapped index is one this version can search.
+static bool index_valid(const index_header_t* index, size_t size)
+{
+	return size >= sizeof(index_header_t)
+		&& index->magic == CACHE_MAGIC
+		&& index->version == CACHE_VERSION
+		&& index->capacity > 0
+		&& (index->capacity & (index->capacity - 1)) == 0
+		&& size >= sizeof(index_header_t) + (size_t)index->capacity * sizeof(index_slot_t);
+}
+
+// Returns a copy of 'dir' joined with 'name', which must be freed.
+static char* join_path(const char* dir, const char* name)
+{
+	size_t dir_length = strlen(dir);
+	char* path = malloc(dir_length + strlen(name) + 2);
+	strcpy(path, dir);
+	path[dir_length] = '/';
+	strcpy(path + dir_length + 1, name);
+	return path;
+}
+
+code_cache_t* cache_open(const char* dir)
+{
+	if(mkdir(dir, 0755) < 0 && errno != EEXIST)
+	{
+		return NULL;
+	}
+
+	code_cache_t* cache = calloc(1, sizeof(code_cache_t));
+	cache->dir = strdup(dir);
+	cache->index_path = join_path(dir, "index");
+	cache->data_path = join_path(dir, "data");
+	pthread_mutex_init(&cache->lock, NULL);
+
+	int fd = open(cache->data_path, O_RDWR | O_CREAT, 0644);
+	if(fd < 0)
+	{
+		cache_close(cache);
+		return NULL;
+	}
+
+	// Writers hold an exclusive lock while they update the files, so both
+	// are mapped in a consistent state.
+	flock(fd, LOCK_SH);
+	cache->index = map_whole_file(cache->index_path, &cache->index_size);
+	cache->data = map_whole_file(cache->data_path, &cache->data_size);
+	flock(fd, LOCK_UN);
+	close(fd);
+
+	if(cache->index && !index_valid(cache->index, cache->index_size))
+	{
+		munmap((void*)cache->index, cache->index_size);
+		cache->index = NULL;
+	}
+
+	return cache;
+}
+
+// Fills in an entry from the record at the given address, which must have
+// at least 'available' bytes after it.
+// Returns false if the record does not fit, which means the files are corrupt.
+static bool read_record(const char* record, size_t available, cache_entry_t* entry)
+{
+	const record_header_t* header = (const record_header_t*)record;
+	if(available < sizeof(record_header_t) || available < record_size(header))
+	{
+		return false;
+	}
+
+	entry->labels = (const emit_label_ref_t*)(record + sizeof(record_header_t));
+	entry->label_ref_count = header->label_ref_count;
+	entry->label_count = header->label_count;
+	entry->text = (const char*)(entry->labels + header->label_ref_count);
+	entry->text_length = header->text_length;
+
+	// Labels are spliced into the text in order, so their offsets must be too.
+	uint32_t offset = 0;
+	for(uint32_t i = 0; i < entry->label_ref_count; i++)
+	{
+		if(entry->labels[i].offset < offset || entry->labels[i].offset > entry->text_length)
+		{
+			return false;
+		}
+		offset = entry->labels[i].offset;
+	}
+	return true;
+}
+
+bool cache_lookup(code_cache_t* cache, uint64_t key, cache_entry_t* entry)
+{
+	if(cache->index == NULL || cache->data == NULL)
+	{
+		return false;
+	}
+
+	index_slot_t* slots = (index_slot_t*)(cache->index + 1);
+	index_slot_t* slot = find_slot(slots, cache->index->capacity, slot_key(key));
+	if(slot->key == 0 || slot->offset >= cache->data_size)
+	{
+		return false;
+	}
+
+	return read_record(cache->data + slot->offset, cache->data_size - slot->offset, entry);
+}
+
+void cache_insert(code_cache_t* cache, uint64_t key, const cache_entry_t* entry)
+{
+	record_header_t header;
+	memset(&header, 0, sizeof(header));
+	header.text_length = entry->text_length;
+	header.label_ref_count = entry->label_ref_count;
+	header.label_count = entry->label_count;
+
+	size_t size = record_size(&header);
+	size_t labels_size = entry->label_ref_count * sizeof(emit_label_ref_t);
+
+	pthread_mutex_lock(&cache->lock);
+
+	// Stretchy buffers are limited to INT_MAX bytes, anything beyond that is
+	// simply not cached.
+	if((size_t)sb_count(cache->pending_data) + size <= INT_MAX)
+	{
+		pending_t pending;
+		pending.key = slot_key(key);
+		pending.offset = sb_count(cache->pending_data);
+		sb_push(cache->pending, pending);
+
+		char* record = sb_add(cache->pending_data, (int)size);
+		memset(record, 0, size);
+		memcpy(record, &header, sizeof(header));
+		memcpy(record + sizeof(header), entry->labels, labels_size);
+		memcpy(record + sizeof(header) + labels_size, entry->text, entry->text_length);
+	}
+
+	pthread_mutex_unlock(&cache->lock);
+}
+
+// Writes 'len' bytes to the file descriptor, returns false on failure.
+static bool write_all(int fd, const void* bytes, size_t len)
+{
+	size_t written = 0;
+	while(written < len)
+	{
+		ssize_t r = write(fd, (const char*)bytes + written, len - written);
+		if(r < 0)
+		{
+			return false;
+		}
+		written += r;
+	}
+	return true;
+}
+
+// Appends the pending records to the data file and writes a new index which
+// includes them. The caller holds the exclusive lock on the data file.
+static void merge_pending(code_cache_t* cache, int data_fd)
+{
+	// The index may have been updated by another compiler since this cache
+	// was opened, so start from whatever is on disk now.
+	size_t index_size = 0;
+	const index_header_t* index = map_whole_file(cache->index_path, &index_size);
+	if(index && !index_valid(index, index_size))
+	{
+		munmap((void*)index, index_size);
+		index = NULL;
+	}
+
+	uint32_t count = index ? index->count : 0;
+	uint64_t needed = (uint64_t)(count + sb_count(cache->pending)) * 2;
+	uint32_t capacity = CACHE_MIN_CAPACITY;
+	while(capacity < needed)
+	{
+		capacity *= 2;
+	}
+
+	index_slot_t* slots = calloc(capacity, sizeof(index_slot_t));
+	if(index)
+	{
+		const index_slot_t* old = (const index_slot_t*)(index + 1);
+		for(uint32_t i = 0; i < index->capacity; i++)
+		{
+			if(old[i].key)
+			{
+				*find_slot(slots, capacity, old[i].key) = old[i];
+			}
+		}
+		munmap((void*)index, index_size);
+	}
+
+	// Records are appended after whatever is already there, which is always
+	// a whole number of records.
+	off_t start = lseek(data_fd, 0, SEEK_END);
+	off_t end = start;
+	bool ok = start >= 0;
+
+	for(int i = 0; ok && i < sb_count(cache->pending); i++)
+	{
+		pending_t* pending = &cache->pending[i];
+		index_slot_t* slot = find_slot(slots, capacity, pending->key);
+		if(slot->key)
+		{
+			continue;
+		}
+
+		const char* record = cache->pending_data + pending->offset;
+		size_t size = record_size((const record_header_t*)record);
+		ok = write_all(data_fd, record, size);
+
+		slot->key = pending->key;
+		slot->offset = end;
+		end += size;
+		count++;
+	}
+
+	if(ok)
+	{
+		index_header_t header;
+		header.magic = CACHE_MAGIC;
+		header.version = CACHE_VERSION;
+		header.capacity = capacity;
+		header.count = count;
+
+		// Mapped copies of the old index stay valid once it is replaced.
+		char* temp_path = join_path(cache->dir, "index.tmp");
+		int fd = open(temp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if(fd >= 0)
+		{
+			ok = write_all(fd, &header, sizeof(header)) && write_all(fd, slots, capacity * sizeof(index_slot_t));
+			ok = close(fd) == 0 && ok;
+			if(ok)
+			{
+				rename(temp_path, cache->index_path);
+			}
+			else
+			{
+				unlink(temp_path);
+			}
+		}
+		free(temp_path);
+	}
+
+	// Records which are not in the index would never be read, and a partly
+	// written one would misplace every record appended after it.
+	if(!ok && start >= 0)
+	{
+		ftruncate(data_fd, start);
+	}
+
+	free(slots);
+}
+
+void cache_close(code_cache_t* cache)
+{
+	if(cache == NULL)
+	{
+		return;
+	}
+
+	if(sb_count(cache->pending) > 0)
+	{
+		int fd = open(cache->data_path, O_RDWR | O_CREAT, 0644);
+		if(fd >= 0)
+		{
+			flock(fd, LOCK_EX);
+			merge_pending(cache, fd);
+			flock(fd, LOCK_UN);
+			close(fd);
+		}
+	}
+
+	if(cache->index)
+	{
+		munmap((void*)cache->index, cache->index_size);
+	}
+	if(cache->data)
+	{
+		munmap((void*)cache->data, cache->data_size);
+	}
+
+	sb_free(cache->pending);
+	sb_free(cache->pending_data);
+	pthread_mutex_destroy(&cache->lock);
+	free(cache->dir);
+	free(cache->index_path);
+	free(cache->data_path);
+	free(cache);
+}
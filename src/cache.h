@@ -0,0 +1,57 @@
+#ifndef _CACHE_H
+#define _CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "emitter.h"
+
+// An on-disk cache of the assembly generated for each function, so that
+// functions which have not changed since an earlier compile do not have to
+// be generated again.
+//
+// A cache directory holds two files. 'data' is only ever appended to, and
+// holds the assembly of every cached function. 'index' is an open-addressing
+// hash table from key to record in 'data', which is memory-mapped and
+// searched in place. Both are mapped when the cache is opened, so lookups
+// see the cache as it was at that point.
+//
+// Functions generated while the cache is open are held in memory, and are
+// merged into the files by 'cache_close()' under an exclusive lock, so any
+// number of compilers may share a cache directory.
+//
+// A cache may be used from several threads at once.
+
+typedef struct code_cache code_cache_t;
+
+// Assembly of a cached function. The text does not contain the names of the
+// labels it refers to, each of which is relative to the first label the
+// function defined, see 'emit_capture_begin()'.
+typedef struct
+{
+	const char* text;
+	uint32_t text_length;
+
+	const emit_label_ref_t* labels;
+	uint32_t label_ref_count;
+
+	// Number of label ids the function used.
+	uint32_t label_count;
+} cache_entry_t;
+
+// Opens the cache in the given directory, creating it if needed.
+// Returns NULL if the directory cannot be used.
+code_cache_t* cache_open(const char* dir);
+
+// Writes out every function added since the cache was opened, and releases
+// the cache.
+void cache_close(code_cache_t* cache);
+
+// Looks up the function with the given key, returning false if it is not in
+// the cache. The entry stays valid until the cache is closed.
+bool cache_lookup(code_cache_t* cache, uint64_t key, cache_entry_t* entry);
+
+// Adds a function to the cache, its contents are copied.
+void cache_insert(code_cache_t* cache, uint64_t key, const cache_entry_t* entry);
+
+#endif
@@ -0,0 +1,269 @@
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "emitter.h"
+#include "error.h"
+#include "buf.h"
+
+// State for the emitter, each thread has its own.
+// The state is reset with each call to 'emit_begin()'.
+static _Thread_local struct
+{
+	// Descriptor the output is written to, or -1 if it is collected in
+	// 'memory' instead.
+	int fd;
+	char** memory;
+
+	// Where output goes before it is written out. When collecting in memory
+	// this is the stretchy buffer itself, whose length is only brought up to
+	// date when it grows and by 'emit_end()'. Otherwise it is 'file_buffer',
+	// which is only allocated once the thread first writes to a descriptor,
+	// and is kept for the next time.
+	char* buffer;
+	size_t capacity;
+	size_t used;
+	char* file_buffer;
+
+	// Destinations of captured output, or NULL when not capturing. Bytes of
+	// the buffer from 'captured' onwards have not been copied yet.
+	char** capture_text;
+	emit_label_ref_t** capture_labels;
+	size_t captured;
+} state;
+
+// Register names, indexed first by width and then by register.
+static const char* const reg_names_8[] =
+{
+	"%al", "%cl", "%dl", "%bl", "%spl", "%bpl", "%sil", "%dil",
+	"%r8b", "%r9b", "%r10b", "%r11b", "%r12b", "%r13b", "%r14b", "%r15b"
+};
+
+static const char* const reg_names_32[] =
+{
+	"%eax", "%ecx", "%edx", "%ebx", "%esp", "%ebp", "%esi", "%edi",
+	"%r8d", "%r9d", "%r10d", "%r11d", "%r12d", "%r13d", "%r14d", "%r15d"
+};
+
+static const char* const reg_names_64[] =
+{
+	"%rax", "%rcx", "%rdx", "%rbx", "%rsp", "%rbp", "%rsi", "%rdi",
+	"%r8", "%r9", "%r10", "%r11", "%r12", "%r13", "%r14", "%r15"
+};
+
+// Writes 'len' bytes to the file descriptor, retrying on short writes.
+static void write_all(const char* bytes, size_t len)
+{
+	size_t written = 0;
+	while(written < len)
+	{
+		ssize_t r = write(state.fd, bytes + written, len - written);
+		if(r < 0)
+		{
+			error("unable to write output\n");
+		}
+		written += r;
+	}
+}
+
+// Copies whatever has been buffered since the last call into the capture.
+static void capture()
+{
+	if(state.capture_text)
+	{
+		size_t len = state.used - state.captured;
+		memcpy(sb_add(*state.capture_text, len), state.buffer + state.captured, len);
+	}
+	state.captured = state.used;
+}
+
+// Writes the entire buffer out to the file descriptor and empties it.
+static void flush()
+{
+	capture();
+	write_all(state.buffer, state.used);
+	state.used = 0;
+	state.captured = 0;
+}
+
+// Makes room for at least 'len' more bytes in the stretchy buffer output is
+// collected in.
+static void grow(size_t len)
+{
+	char** memory = state.memory;
+	if(*memory)
+	{
+		stb__sbn(*memory) = (int)state.used;
+	}
+	stb__sbgrow(*memory, (int)len);
+	state.buffer = *memory;
+	state.capacity = stb__sbm(*memory);
+}
+
+// Returns a pointer to at least 'len' free bytes at the end of the buffer.
+// 'len' must not exceed EMITTER_BUFFER_SIZE.
+static char* reserve(size_t len)
+{
+	if(state.used + len > state.capacity)
+	{
+		if(state.memory)
+		{
+			grow(len);
+		}
+		else
+		{
+			flush();
+		}
+	}
+	return state.buffer + state.used;
+}
+
+void emit_begin(int fd)
+{
+	if(state.file_buffer == NULL)
+	{
+		state.file_buffer = malloc(EMITTER_BUFFER_SIZE);
+		if(state.file_buffer == NULL)
+		{
+			error("out of memory\n");
+		}
+	}
+
+	state.fd = fd;
+	state.memory = NULL;
+	state.buffer = state.file_buffer;
+	state.capacity = EMITTER_BUFFER_SIZE;
+	state.used = 0;
+	state.captured = 0;
+	state.capture_text = NULL;
+}
+
+void emit_begin_memory(char** output)
+{
+	state.fd = -1;
+	state.memory = output;
+	state.buffer = *output;
+	state.capacity = *output ? stb__sbm(*output) : 0;
+	state.used = sb_count(*output);
+	state.captured = state.used;
+	state.capture_text = NULL;
+}
+
+void emit_end()
+{
+	if(state.memory)
+	{
+		capture();
+		if(*state.memory)
+		{
+			stb__sbn(*state.memory) = (int)state.used;
+		}
+		return;
+	}
+	flush();
+}
+
+void emit_bytes(const char* bytes, size_t len)
+{
+	if(len > EMITTER_BUFFER_SIZE && !state.memory)
+	{
+		// Too large to ever be buffered, write it straight through.
+		flush();
+		if(state.capture_text)
+		{
+			memcpy(sb_add(*state.capture_text, len), bytes, len);
+		}
+		write_all(bytes, len);
+		return;
+	}
+
+	memcpy(reserve(len), bytes, len);
+	state.used += len;
+}
+
+void emit_str(const char* str)
+{
+	emit_bytes(str, strlen(str));
+}
+
+void emit_char(char c)
+{
+	*reserve(1) = c;
+	state.used++;
+}
+
+void emit_int(int64_t value)
+{
+	// Digits are produced least significant first into the end of a scratch
+	// buffer. The magnitude is computed unsigned so that INT64_MIN works.
+	char digits[20];
+	char* end = digits + sizeof(digits);
+	char* p = end;
+
+	uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+	do
+	{
+		*--p = '0' + (magnitude % 10);
+		magnitude /= 10;
+	} while(magnitude);
+
+	char* out = reserve(21);
+	if(value < 0)
+	{
+		*out++ = '-';
+		state.used++;
+	}
+	memcpy(out, p, end - p);
+	state.used += end - p;
+}
+
+void emit_reg(reg_t reg, width_t width)
+{
+	switch(width)
+	{
+	case WIDTH_8:  emit_str(reg_names_8[reg]);  break;
+	case WIDTH_32: emit_str(reg_names_32[reg]); break;
+	case WIDTH_64: emit_str(reg_names_64[reg]); break;
+	default: UNHANDLED_CASE();
+	}
+}
+
+void emit_label(int label)
+{
+	// The name is not part of the captured text, so capturing is suspended
+	// while it is emitted.
+	char** text = state.capture_text;
+	if(text)
+	{
+		capture();
+		state.capture_text = NULL;
+
+		emit_label_ref_t ref;
+		ref.offset = sb_count(*text);
+		ref.label = label;
+		sb_push(*state.capture_labels, ref);
+	}
+
+	emit_lit("_label");
+	emit_int(label);
+
+	if(text)
+	{
+		state.captured = state.used;
+		state.capture_text = text;
+	}
+}
+
+void emit_capture_begin(char** text, emit_label_ref_t** labels)
+{
+	state.captured = state.used;
+	state.capture_text = text;
+	state.capture_labels = labels;
+}
+
+void emit_capture_end()
+{
+	capture();
+	state.capture_text = NULL;
+	state.capture_labels = NULL;
+}
@@ -0,0 +1,91 @@
+#ifndef _EMITTER_H
+#define _EMITTER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Size of the buffer output to a file descriptor goes through. Output is
+// written to the descriptor whenever the buffer fills up, and once more by
+// 'emit_end()'. Output collected in memory is written straight into place.
+#define EMITTER_BUFFER_SIZE (1024 * 1024)
+
+// Appends a string literal, its length is computed at compile time.
+#define emit_lit(s) emit_bytes((s), sizeof(s) - 1)
+
+// General purpose registers, the names of which depend on the operand width.
+typedef enum
+{
+	REG_AX,
+	REG_CX,
+	REG_DX,
+	REG_BX,
+	REG_SP,
+	REG_BP,
+	REG_SI,
+	REG_DI,
+	REG_R8,
+	REG_R9,
+	REG_R10,
+	REG_R11,
+	REG_R12,
+	REG_R13,
+	REG_R14,
+	REG_R15
+} reg_t;
+
+// Operand widths, in bytes.
+typedef enum
+{
+	WIDTH_8 = 1,
+	WIDTH_32 = 4,
+	WIDTH_64 = 8
+} width_t;
+
+// A label referenced by captured output, see 'emit_capture_begin()'.
+typedef struct
+{
+	// Offset within the captured output at which the label's name belongs.
+	uint32_t offset;
+	int label;
+} emit_label_ref_t;
+
+// Starts buffering output destined for the given file descriptor.
+void emit_begin(int fd);
+
+// Starts collecting output at the end of the given stretchy buffer, which
+// may be NULL. The buffer is not NUL terminated.
+void emit_begin_memory(char** output);
+
+// Writes out any buffered output.
+// If the output cannot be written, the program will terminate and an
+// error message will be printed to the user.
+void emit_end();
+
+// Appends 'len' bytes to the output.
+void emit_bytes(const char* bytes, size_t len);
+
+// Appends a NUL terminated string to the output.
+void emit_str(const char* str);
+
+// Appends a single character to the output.
+void emit_char(char c);
+
+// Appends the decimal representation of the given integer to the output.
+void emit_int(int64_t value);
+
+// Appends the AT&T name of the given register, including the '%' prefix.
+void emit_reg(reg_t reg, width_t width);
+
+// Appends the name of the label with the given id.
+void emit_label(int label);
+
+// Starts copying everything emitted onto the end of the stretchy buffer
+// 'text', as well as writing it out as usual. Label names are left out of
+// the copy, and are instead recorded in the stretchy buffer 'labels'.
+// Output captured this way can be replayed with different label ids.
+void emit_capture_begin(char** text, emit_label_ref_t** labels);
+
+// Stops capturing output.
+void emit_capture_end();
+
+#endif
@@ -1,12 +1,26 @@
 #include "error.h"
 
+static _Thread_local error_recovery_t* recovery_point;
+
 _Noreturn void error(char* fmt, ...)
 {
 	va_list args;
 	va_start(args, fmt);
+
+	if(recovery_point)
+	{
+		vsnprintf(recovery_point->message, ERROR_MESSAGE_SIZE, fmt, args);
+		va_end(args);
+		longjmp(recovery_point->env, 1);
+	}
+
 	vfprintf(stderr, fmt, args);
 	va_end(args);
 
 	exit(EXIT_FAILURE);
 }
 
+void error_set_recovery(error_recovery_t* recovery)
+{
+	recovery_point = recovery;
+}
@@ -4,12 +4,38 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdarg.h>
+#include <setjmp.h>
 #include <stdnoreturn.h>
 
 #define UNHANDLED_CASE() error("unhandled case @ %s:%d\n", __FILE__, __LINE__)
 
+// Maximum length of a recovered error message, longer messages are truncated.
+#define ERROR_MESSAGE_SIZE 256
+
+// A point on the current thread which 'error()' returns to, rather than
+// exiting the program.
+typedef struct
+{
+	jmp_buf env;
+	char message[ERROR_MESSAGE_SIZE];
+} error_recovery_t;
+
 // Fatally exits the program with the given error message.
-// NOTE: This function calls exit() and as such, does not return.
+// If the calling thread has set a recovery point, the message is stored in it
+// and control returns to the matching 'setjmp()' instead.
+// NOTE: This function does not return.
 _Noreturn void error(char* fmt, ...);
 
+// Sets the recovery point used by 'error()' on the calling thread, or clears
+// it when given NULL. The caller must 'setjmp()' on 'recovery->env' first:
+//
+//     error_recovery_t recovery;
+//     if(setjmp(recovery.env) == 0)
+//     {
+//         error_set_recovery(&recovery);
+//         ...
+//     }
+//     error_set_recovery(NULL);
+void error_set_recovery(error_recovery_t* recovery);
+
 #endif
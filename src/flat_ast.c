@@ -0,0 +1,192 @@
+#include "flat_ast.h"
+
+// State used while flattening, each thread has its own.
+// The state is reset with each call to 'flatten_program()'.
+static _Thread_local struct
+{
+	flat_ast_t* ast;
+
+	// Maps interned names to their index in 'ast->names', so each distinct
+	// name is stored once. Open addressing keyed by pointer.
+	str_t* name_keys;
+	flat_id_t* name_ids;
+	uint32_t name_capacity;
+} state;
+
+// Returns the index of the given name in the names pool, adding it if needed.
+static flat_id_t add_name(str_t name)
+{
+	if((uint32_t)(sb_count(state.ast->names) + 1) * 2 > state.name_capacity)
+	{
+		// Grow the map, re-inserting every name already in the pool.
+		free(state.name_keys);
+		free(state.name_ids);
+		state.name_capacity = state.name_capacity ? state.name_capacity * 2 : 256;
+		state.name_keys = calloc(state.name_capacity, sizeof(str_t));
+		state.name_ids = malloc(state.name_capacity * sizeof(flat_id_t));
+
+		uint32_t mask = state.name_capacity - 1;
+		for(int i = 0; i < sb_count(state.ast->names); i++)
+		{
+			uint32_t slot = ((uintptr_t)state.ast->names[i] >> 3) & mask;
+			while(state.name_keys[slot])
+			{
+				slot = (slot + 1) & mask;
+			}
+			state.name_keys[slot] = state.ast->names[i];
+			state.name_ids[slot] = i;
+		}
+	}
+
+	uint32_t mask = state.name_capacity - 1;
+	uint32_t slot = ((uintptr_t)name >> 3) & mask;
+	while(state.name_keys[slot])
+	{
+		if(state.name_keys[slot] == name)
+		{
+			return state.name_ids[slot];
+		}
+		slot = (slot + 1) & mask;
+	}
+
+	flat_id_t id = sb_count(state.ast->names);
+	sb_push(state.ast->names, name);
+	state.name_keys[slot] = name;
+	state.name_ids[slot] = id;
+	return id;
+}
+
+// Appends a new expression to the pool, returning its index.
+static flat_id_t add_expr(expr_type_t kind, int op, flat_id_t a, flat_id_t b)
+{
+	flat_ast_t* ast = state.ast;
+	flat_id_t id = sb_count(ast->expr_kind);
+	sb_push(ast->expr_kind, kind);
+	sb_push(ast->expr_op, op);
+	sb_push(ast->expr_a, a);
+	sb_push(ast->expr_b, b);
+	return id;
+}
+
+static flat_id_t flatten_expr(expr_t* expr)
+{
+	switch(expr->type)
+	{
+	case EXPR_LITERAL: {
+		flat_id_t literal = sb_count(state.ast->literals);
+		sb_push(state.ast->literals, expr->value);
+		return add_expr(EXPR_LITERAL, 0, literal, FLAT_NONE);
+	}
+	case EXPR_UNARY: {
+		flat_id_t operand = flatten_expr(expr->unary_operand);
+		return add_expr(EXPR_UNARY, expr->unary_operator, operand, FLAT_NONE);
+	}
+	case EXPR_BINARY: {
+		flat_id_t lhs = flatten_expr(expr->binary_lhs);
+		flat_id_t rhs = flatten_expr(expr->binary_rhs);
+		return add_expr(EXPR_BINARY, expr->binary_operator, lhs, rhs);
+	}
+	case EXPR_ASSIGNMENT: {
+		flat_id_t rhs = flatten_expr(expr->assign_rhs);
+		return add_expr(EXPR_ASSIGNMENT, 0, rhs, add_name(expr->assign_name));
+	}
+	case EXPR_VAR: {
+		return add_expr(EXPR_VAR, 0, FLAT_NONE, add_name(expr->var_name));
+	}
+	default: {
+		UNHANDLED_CASE();
+	}
+	}
+}
+
+// Flattens every statement of a function. Expressions are flattened first
+// so that the statements themselves end up contiguous in their pool.
+static flat_id_t flatten_stmts(stmt_t** stmts, int count)
+{
+	flat_id_t* exprs = malloc(count * sizeof(flat_id_t));
+	for(int i = 0; i < count; i++)
+	{
+		stmt_t* stmt = stmts[i];
+		switch(stmt->type)
+		{
+		case STMT_EXPR:    exprs[i] = flatten_expr(stmt->standalone_expr); break;
+		case STMT_RETURN:  exprs[i] = flatten_expr(stmt->return_expr);     break;
+		case STMT_DECLARE: {
+			exprs[i] = stmt->declare_initializer ? flatten_expr(stmt->declare_initializer) : FLAT_NONE;
+		} break;
+		default: UNHANDLED_CASE();
+		}
+	}
+
+	flat_ast_t* ast = state.ast;
+	flat_id_t first = sb_count(ast->stmt_kind);
+	for(int i = 0; i < count; i++)
+	{
+		stmt_t* stmt = stmts[i];
+		sb_push(ast->stmt_kind, stmt->type);
+		sb_push(ast->stmt_expr, exprs[i]);
+		sb_push(ast->stmt_name, stmt->type == STMT_DECLARE ? add_name(stmt->declare_name) : FLAT_NONE);
+	}
+
+	free(exprs);
+	return first;
+}
+
+static void flatten_decl(decl_t* decl)
+{
+	switch(decl->type)
+	{
+	case DECL_FUNC: {
+		flat_id_t first = flatten_stmts(decl->stmts, decl->stmt_count);
+
+		flat_ast_t* ast = state.ast;
+		sb_push(ast->decl_kind, DECL_FUNC);
+		sb_push(ast->decl_name, add_name(decl->name));
+		sb_push(ast->decl_first_stmt, first);
+		sb_push(ast->decl_stmt_count, decl->stmt_count);
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+void flatten_program(flat_ast_t* ast, program_t* program)
+{
+	memset(ast, 0, sizeof(flat_ast_t));
+
+	state.ast = ast;
+	state.name_keys = NULL;
+	state.name_ids = NULL;
+	state.name_capacity = 0;
+
+	for(int i = 0; i < program->decl_count; i++)
+	{
+		flatten_decl(program->decls[i]);
+	}
+
+	free(state.name_keys);
+	free(state.name_ids);
+}
+
+void free_flat_ast(flat_ast_t* ast)
+{
+	sb_free(ast->expr_kind);
+	sb_free(ast->expr_op);
+	sb_free(ast->expr_a);
+	sb_free(ast->expr_b);
+
+	sb_free(ast->stmt_kind);
+	sb_free(ast->stmt_expr);
+	sb_free(ast->stmt_name);
+
+	sb_free(ast->decl_kind);
+	sb_free(ast->decl_name);
+	sb_free(ast->decl_first_stmt);
+	sb_free(ast->decl_stmt_count);
+
+	sb_free(ast->literals);
+	sb_free(ast->names);
+
+	memset(ast, 0, sizeof(flat_ast_t));
+}
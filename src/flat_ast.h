@@ -0,0 +1,166 @@
+#ifndef _FLAT_AST_H
+#define _FLAT_AST_H
+
+#include <stdint.h>
+
+#include "parser.h"
+#include "buf.h"
+
+// An index-based view of the AST, which only '--flat-ast' prints.
+// Nodes of each kind live in their own pool and refer to each other by
+// 32-bit index rather than by pointer, with each field in an array of its
+// own. The view is built from the tree once the whole program is parsed, and
+// nothing else reads it: the folder and the generators walk the tree, so it
+// costs memory on top of the tree rather than saving any.
+
+typedef uint32_t flat_id_t;
+
+// Marks an absent child, such as a declaration without an initializer.
+#define FLAT_NONE ((flat_id_t)-1)
+
+typedef struct
+{
+	// Expression pool. The meaning of 'expr_a' and 'expr_b' depends on the
+	// kind of the expression:
+	//   EXPR_LITERAL     a = index into 'literals'
+	//   EXPR_UNARY       a = operand
+	//   EXPR_BINARY      a = lhs, b = rhs
+	//   EXPR_ASSIGNMENT  a = rhs, b = index into 'names'
+	//   EXPR_VAR         b = index into 'names'
+	uint8_t* expr_kind;
+	uint8_t* expr_op;
+	flat_id_t* expr_a;
+	flat_id_t* expr_b;
+
+	// Statement pool, the statements of each function are contiguous.
+	//   STMT_EXPR     expr = expression
+	//   STMT_RETURN   expr = returned expression
+	//   STMT_DECLARE  expr = initializer or FLAT_NONE, name = index into 'names'
+	uint8_t* stmt_kind;
+	flat_id_t* stmt_expr;
+	flat_id_t* stmt_name;
+
+	// Declaration pool.
+	uint8_t* decl_kind;
+	flat_id_t* decl_name;
+	flat_id_t* decl_first_stmt;
+	uint32_t* decl_stmt_count;
+
+	// Out of line operand storage.
+	uint64_t* literals;
+	str_t* names;
+} flat_ast_t;
+
+// Builds a flat view of the given program. The program may be freed once
+// this returns.
+void flatten_program(flat_ast_t* ast, program_t* program);
+
+// Releases all storage held by the given flat AST.
+void free_flat_ast(flat_ast_t* ast);
+
+//
+// Expression accessors.
+//
+
+static inline expr_type_t flat_expr_type(const flat_ast_t* ast, flat_id_t expr)
+{
+	return (expr_type_t)ast->expr_kind[expr];
+}
+
+static inline uint64_t flat_literal_value(const flat_ast_t* ast, flat_id_t expr)
+{
+	return ast->literals[ast->expr_a[expr]];
+}
+
+static inline unary_operator_t flat_unary_operator(const flat_ast_t* ast, flat_id_t expr)
+{
+	return (unary_operator_t)ast->expr_op[expr];
+}
+
+static inline flat_id_t flat_unary_operand(const flat_ast_t* ast, flat_id_t expr)
+{
+	return ast->expr_a[expr];
+}
+
+static inline binary_operator_t flat_binary_operator(const flat_ast_t* ast, flat_id_t expr)
+{
+	return (binary_operator_t)ast->expr_op[expr];
+}
+
+static inline flat_id_t flat_binary_lhs(const flat_ast_t* ast, flat_id_t expr)
+{
+	return ast->expr_a[expr];
+}
+
+static inline flat_id_t flat_binary_rhs(const flat_ast_t* ast, flat_id_t expr)
+{
+	return ast->expr_b[expr];
+}
+
+static inline str_t flat_assign_name(const flat_ast_t* ast, flat_id_t expr)
+{
+	return ast->names[ast->expr_b[expr]];
+}
+
+static inline flat_id_t flat_assign_rhs(const flat_ast_t* ast, flat_id_t expr)
+{
+	return ast->expr_a[expr];
+}
+
+static inline str_t flat_var_name(const flat_ast_t* ast, flat_id_t expr)
+{
+	return ast->names[ast->expr_b[expr]];
+}
+
+//
+// Statement accessors.
+//
+
+static inline stmt_type_t flat_stmt_type(const flat_ast_t* ast, flat_id_t stmt)
+{
+	return (stmt_type_t)ast->stmt_kind[stmt];
+}
+
+// Returns the expression of a STMT_EXPR or STMT_RETURN, or the initializer
+// of a STMT_DECLARE which may be FLAT_NONE.
+static inline flat_id_t flat_stmt_expr(const flat_ast_t* ast, flat_id_t stmt)
+{
+	return ast->stmt_expr[stmt];
+}
+
+static inline str_t flat_declare_name(const flat_ast_t* ast, flat_id_t stmt)
+{
+	return ast->names[ast->stmt_name[stmt]];
+}
+
+//
+// Declaration accessors.
+//
+
+static inline int flat_decl_count(const flat_ast_t* ast)
+{
+	return sb_count(ast->decl_kind);
+}
+
+static inline decl_type_t flat_decl_type(const flat_ast_t* ast, flat_id_t decl)
+{
+	return (decl_type_t)ast->decl_kind[decl];
+}
+
+static inline str_t flat_decl_name(const flat_ast_t* ast, flat_id_t decl)
+{
+	return ast->names[ast->decl_name[decl]];
+}
+
+static inline int flat_decl_stmt_count(const flat_ast_t* ast, flat_id_t decl)
+{
+	return ast->decl_stmt_count[decl];
+}
+
+// Returns the i'th statement of the given function.
+static inline flat_id_t flat_decl_stmt(const flat_ast_t* ast, flat_id_t decl, int i)
+{
+	return ast->decl_first_stmt[decl] + i;
+}
+
+#endif
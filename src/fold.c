@@ -0,0 +1,371 @@
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "fold.h"
+#include "stats.h"
+
+static void fold_expr(expr_t* expr);
+
+// Returns the value of a literal as the generated code sees it, the low
+// 32 bits of the parsed value.
+static int32_t literal_value(expr_t* expr)
+{
+	return (int32_t)(uint32_t)expr->value;
+}
+
+// Replaces the expression with a literal of the given value.
+static void make_literal(expr_t* expr, int32_t value)
+{
+	expr->type = EXPR_LITERAL;
+	expr->value = (uint64_t)(int64_t)value;
+	STAT_INC(folds);
+}
+
+// Replaces the expression with one of its operands.
+static void replace_with(expr_t* expr, expr_t* operand)
+{
+	*expr = *operand;
+	STAT_INC(simplifications);
+}
+
+// Returns true if the expression is a literal of the given value.
+static bool is_literal(expr_t* expr, int32_t value)
+{
+	return expr->type == EXPR_LITERAL && literal_value(expr) == value;
+}
+
+// Returns true if evaluating the expression could do more than produce its
+// value, by assigning to a variable or by dividing in a way which may trap.
+static bool has_side_effects(expr_t* expr)
+{
+	switch(expr->type)
+	{
+	case EXPR_LITERAL:
+	case EXPR_VAR: {
+		return false;
+	} break;
+	case EXPR_UNARY: {
+		return has_side_effects(expr->unary_operand);
+	} break;
+	case EXPR_BINARY: {
+		if(expr->binary_operator == BINARY_DIV || expr->binary_operator == BINARY_MODULO)
+		{
+			expr_t* divisor = expr->binary_rhs;
+			if(divisor->type != EXPR_LITERAL || is_literal(divisor, 0) || is_literal(divisor, -1))
+			{
+				return true;
+			}
+		}
+		return has_side_effects(expr->binary_lhs) || has_side_effects(expr->binary_rhs);
+	} break;
+	case EXPR_ASSIGNMENT: {
+		return true;
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+	return true;
+}
+
+// Removes operations which leave their operand unchanged, and replaces those
+// whose result does not depend on the other operand, when that operand can
+// safely go unevaluated.
+static void simplify_binary_expr(expr_t* expr)
+{
+	expr_t* lhs = expr->binary_lhs;
+	expr_t* rhs = expr->binary_rhs;
+
+	switch(expr->binary_operator)
+	{
+	case BINARY_ADD:
+	case BINARY_BITWISE_OR:
+	case BINARY_BITWISE_XOR: {
+		if(is_literal(rhs, 0))
+		{
+			replace_with(expr, lhs);
+		}
+		else if(is_literal(lhs, 0))
+		{
+			replace_with(expr, rhs);
+		}
+	} break;
+	case BINARY_SUB:
+	case BINARY_SHIFT_LEFT:
+	case BINARY_SHIFT_RIGHT: {
+		if(is_literal(rhs, 0))
+		{
+			replace_with(expr, lhs);
+		}
+	} break;
+	case BINARY_DIV: {
+		if(is_literal(rhs, 1))
+		{
+			replace_with(expr, lhs);
+		}
+	} break;
+	case BINARY_MUL: {
+		if(is_literal(rhs, 1))
+		{
+			replace_with(expr, lhs);
+		}
+		else if(is_literal(lhs, 1))
+		{
+			replace_with(expr, rhs);
+		}
+		else if(is_literal(rhs, 0) && !has_side_effects(lhs))
+		{
+			replace_with(expr, rhs);
+		}
+		else if(is_literal(lhs, 0) && !has_side_effects(rhs))
+		{
+			replace_with(expr, lhs);
+		}
+	} break;
+	case BINARY_BITWISE_AND: {
+		if(is_literal(rhs, -1))
+		{
+			replace_with(expr, lhs);
+		}
+		else if(is_literal(lhs, -1))
+		{
+			replace_with(expr, rhs);
+		}
+		else if(is_literal(rhs, 0) && !has_side_effects(lhs))
+		{
+			replace_with(expr, rhs);
+		}
+		else if(is_literal(lhs, 0) && !has_side_effects(rhs))
+		{
+			replace_with(expr, lhs);
+		}
+	} break;
+	default: {
+	} break;
+	}
+}
+
+static void fold_unary_expr(expr_t* expr)
+{
+	fold_expr(expr->unary_operand);
+
+	// Negating or complementing twice gives back the operand, even for
+	// INT_MIN, whose negation wraps.
+	expr_t* operand = expr->unary_operand;
+	if(operand->type == EXPR_UNARY
+		&& operand->unary_operator == expr->unary_operator
+		&& expr->unary_operator != UNARY_LOGICAL_NEGATE)
+	{
+		replace_with(expr, operand->unary_operand);
+		return;
+	}
+
+	if(expr->unary_operand->type != EXPR_LITERAL)
+	{
+		return;
+	}
+
+	// Negation goes through unsigned arithmetic so that -INT_MIN wraps.
+	uint32_t value = (uint32_t)literal_value(expr->unary_operand);
+	switch(expr->unary_operator)
+	{
+	case UNARY_NEGATE: {
+		make_literal(expr, (int32_t)(0u - value));
+	} break;
+	case UNARY_BITWISE_COMPLEMENT: {
+		make_literal(expr, (int32_t)~value);
+	} break;
+	case UNARY_LOGICAL_NEGATE: {
+		make_literal(expr, value == 0);
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+// Folds a logical operator whose left operand is a literal. The right
+// operand is not evaluated when the left decides the result, so it does not
+// need to be constant.
+static void fold_logical_expr(expr_t* expr)
+{
+	expr_t* lhs = expr->binary_lhs;
+	expr_t* rhs = expr->binary_rhs;
+	if(lhs->type != EXPR_LITERAL)
+	{
+		return;
+	}
+
+	bool left = literal_value(lhs) != 0;
+	bool decided = expr->binary_operator == BINARY_LOGICAL_AND ? !left : left;
+	if(decided)
+	{
+		make_literal(expr, left);
+	}
+	else if(rhs->type == EXPR_LITERAL)
+	{
+		make_literal(expr, literal_value(rhs) != 0);
+	}
+}
+
+static void fold_binary_expr(expr_t* expr)
+{
+	fold_expr(expr->binary_lhs);
+	fold_expr(expr->binary_rhs);
+
+	if(expr->binary_operator == BINARY_LOGICAL_AND || expr->binary_operator == BINARY_LOGICAL_OR)
+	{
+		fold_logical_expr(expr);
+		return;
+	}
+
+	if(expr->binary_lhs->type != EXPR_LITERAL || expr->binary_rhs->type != EXPR_LITERAL)
+	{
+		simplify_binary_expr(expr);
+		return;
+	}
+
+	int32_t lhs = literal_value(expr->binary_lhs);
+	int32_t rhs = literal_value(expr->binary_rhs);
+
+	// Addition, subtraction, multiplication and left shifts are done on
+	// unsigned values, which wrap where the signed ones would overflow.
+	uint32_t ulhs = (uint32_t)lhs;
+	uint32_t urhs = (uint32_t)rhs;
+
+	switch(expr->binary_operator)
+	{
+	case BINARY_ADD: {
+		make_literal(expr, (int32_t)(ulhs + urhs));
+	} break;
+	case BINARY_SUB: {
+		make_literal(expr, (int32_t)(ulhs - urhs));
+	} break;
+	case BINARY_MUL: {
+		make_literal(expr, (int32_t)(ulhs * urhs));
+	} break;
+	case BINARY_DIV: {
+		if(rhs != 0 && !(lhs == INT32_MIN && rhs == -1))
+		{
+			make_literal(expr, lhs / rhs);
+		}
+	} break;
+	case BINARY_MODULO: {
+		if(rhs != 0 && !(lhs == INT32_MIN && rhs == -1))
+		{
+			make_literal(expr, lhs % rhs);
+		}
+	} break;
+	case BINARY_LESS: {
+		make_literal(expr, lhs < rhs);
+	} break;
+	case BINARY_LESS_EQ: {
+		make_literal(expr, lhs <= rhs);
+	} break;
+	case BINARY_GRTR: {
+		make_literal(expr, lhs > rhs);
+	} break;
+	case BINARY_GRTR_EQ: {
+		make_literal(expr, lhs >= rhs);
+	} break;
+	case BINARY_EQUALS: {
+		make_literal(expr, lhs == rhs);
+	} break;
+	case BINARY_NOT_EQ: {
+		make_literal(expr, lhs != rhs);
+	} break;
+	case BINARY_BITWISE_AND: {
+		make_literal(expr, lhs & rhs);
+	} break;
+	case BINARY_BITWISE_OR: {
+		make_literal(expr, lhs | rhs);
+	} break;
+	case BINARY_BITWISE_XOR: {
+		make_literal(expr, lhs ^ rhs);
+	} break;
+	case BINARY_SHIFT_LEFT: {
+		if(rhs >= 0 && rhs < 32)
+		{
+			make_literal(expr, (int32_t)(ulhs << rhs));
+		}
+	} break;
+	case BINARY_SHIFT_RIGHT: {
+		// Right shifts of negative values are arithmetic, as with 'sarl'.
+		if(rhs >= 0 && rhs < 32)
+		{
+			make_literal(expr, lhs < 0 ? ~(~lhs >> rhs) : lhs >> rhs);
+		}
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+static void fold_expr(expr_t* expr)
+{
+	switch(expr->type)
+	{
+	case EXPR_LITERAL:
+	case EXPR_VAR: {
+	} break;
+	case EXPR_UNARY: {
+		fold_unary_expr(expr);
+	} break;
+	case EXPR_BINARY: {
+		fold_binary_expr(expr);
+	} break;
+	case EXPR_ASSIGNMENT: {
+		fold_expr(expr->assign_rhs);
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+static void fold_stmt(stmt_t* stmt)
+{
+	switch(stmt->type)
+	{
+	case STMT_EXPR: {
+		fold_expr(stmt->standalone_expr);
+	} break;
+	case STMT_RETURN: {
+		fold_expr(stmt->return_expr);
+	} break;
+	case STMT_DECLARE: {
+		if(stmt->declare_initializer)
+		{
+			fold_expr(stmt->declare_initializer);
+		}
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+void fold_declaration(decl_t* decl)
+{
+	switch(decl->type)
+	{
+	case DECL_FUNC: {
+		for(int i = 0; i < decl->stmt_count; i++)
+		{
+			fold_stmt(decl->stmts[i]);
+		}
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+void fold_program(program_t* program)
+{
+	for(int i = 0; i < program->decl_count; i++)
+	{
+		fold_declaration(program->decls[i]);
+	}
+}
@@ -0,0 +1,31 @@
+#ifndef _FOLD_H
+#define _FOLD_H
+
+#include "parser.h"
+
+// Constant folding and algebraic simplification, run between parsing and
+// generation.
+//
+// Every unary, binary and logical operator whose operands are literals is
+// evaluated with the semantics of a 32-bit C int, and the expression is
+// replaced in place by an EXPR_LITERAL holding its value. Folding works
+// bottom up, so whole constant subtrees collapse to a single literal.
+//
+// Operations which are undefined in C, namely division or modulo by zero,
+// INT_MIN / -1 and INT_MIN % -1, and shifts by a negative count or by 32 or
+// more, are left alone so that they behave at run time exactly as they did
+// before folding. Signed overflow wraps, as it does in the generated code.
+//
+// Operations with an identity operand, such as 'x + 0', 'x * 1', 'x | 0' and
+// 'x ^ 0', are replaced by their other operand, as are double negations and
+// double complements. 'x * 0' and 'x & 0' become 0 when 'x' has no side
+// effects, that is, it neither assigns nor divides by anything but a nonzero
+// constant other than -1.
+
+// Folds every declaration of the program.
+void fold_program(program_t* program);
+
+// Folds a single declaration.
+void fold_declaration(decl_t* decl);
+
+#endif
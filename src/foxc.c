@@ -0,0 +1,192 @@
+#include <string.h>
+
+#include "foxc.h"
+#include "lex.h"
+#include "parser.h"
+#include "fold.h"
+#include "generator.h"
+#include "error.h"
+#include "stats.h"
+#include "cache.h"
+#include "object.h"
+
+// The working state of the lexer, parser and generator is kept per thread,
+// so a context only needs to own what outlives a compilation.
+struct foxc_context
+{
+	// Stretchy buffer holding the assembly from the last compilation, its
+	// capacity is kept for the next one.
+	char* output;
+
+	// Program being compiled, which is released once it has been generated,
+	// or after an error if generation never got that far.
+	program_t* program;
+
+	char diagnostic[ERROR_MESSAGE_SIZE];
+};
+
+foxc_context_t* foxc_create()
+{
+	return calloc(1, sizeof(foxc_context_t));
+}
+
+void foxc_destroy(foxc_context_t* context)
+{
+	if(context)
+	{
+		sb_free(context->output);
+		free(context);
+	}
+}
+
+static void compile(foxc_context_t* context, const char* source, size_t length)
+{
+	stats_begin(PHASE_LEX);
+	token_t* tokens = lex(source, length);
+	stats_end(PHASE_LEX);
+
+	stats_begin(PHASE_PARSE);
+	context->program = parse(tokens);
+	stats_end(PHASE_PARSE);
+
+	stats_begin(PHASE_OPTIMIZE);
+	fold_program(context->program);
+	stats_end(PHASE_OPTIMIZE);
+
+	stats_begin(PHASE_GENERATE);
+	generate(context->program);
+	stats_end(PHASE_GENERATE);
+
+	free_program(context->program);
+	context->program = NULL;
+}
+
+// Compiles one declaration at a time, see 'compile_streaming()' in main.c.
+static void compile_streaming(const char* source, size_t length)
+{
+	lex_begin(source, length);
+	parse_begin();
+	generate_begin();
+
+	for(;;)
+	{
+		stats_begin(PHASE_PARSE);
+		decl_t* decl = parse_next_decl();
+		stats_end(PHASE_PARSE);
+
+		if(decl == NULL)
+		{
+			break;
+		}
+
+		stats_begin(PHASE_OPTIMIZE);
+		fold_declaration(decl);
+		stats_end(PHASE_OPTIMIZE);
+
+		stats_begin(PHASE_GENERATE);
+		generate_declaration(decl);
+		stats_end(PHASE_GENERATE);
+	}
+
+	generate_end();
+}
+
+foxc_result_t foxc_compile(foxc_context_t* context, const char* source, size_t length, const foxc_options_t* options)
+{
+	foxc_options_t defaults = { 0 };
+	if(options == NULL)
+	{
+		options = &defaults;
+	}
+
+	if(context->output)
+	{
+		stb__sbn(context->output) = 0;
+	}
+
+	foxc_result_t result;
+	memset(&result, 0, sizeof(result));
+
+	error_recovery_t recovery;
+	if(setjmp(recovery.env) == 0)
+	{
+		error_set_recovery(&recovery);
+		generate_set_optimize(options->optimize);
+
+		if(options->object)
+		{
+			object_begin();
+			insn_set_target(TARGET_OBJECT);
+		}
+		else
+		{
+			emit_begin_memory(&context->output);
+			generate_set_cache(options->cache);
+		}
+
+		if(options->stream)
+		{
+			compile_streaming(source, length);
+		}
+		else
+		{
+			compile(context, source, length);
+		}
+
+		if(options->object)
+		{
+			object_write_elf(&context->output);
+		}
+		else
+		{
+			emit_end();
+		}
+
+		result.ok = true;
+	}
+	else
+	{
+		// Diagnostics are returned without their trailing newline.
+		size_t n = strlen(recovery.message);
+		if(n > 0 && recovery.message[n - 1] == '\n')
+		{
+			recovery.message[n - 1] = '\0';
+		}
+		strcpy(context->diagnostic, recovery.message);
+		result.diagnostic = context->diagnostic;
+
+		if(context->program)
+		{
+			free_program(context->program);
+			context->program = NULL;
+		}
+
+		// Discard whatever was generated before the error.
+		if(context->output)
+		{
+			stb__sbn(context->output) = 0;
+		}
+	}
+	error_set_recovery(NULL);
+	generate_set_cache(NULL);
+	generate_set_optimize(false);
+	insn_set_target(TARGET_ASSEMBLY);
+
+	// Terminate the output without counting the terminator.
+	sb_push(context->output, '\0');
+	stb__sbn(context->output)--;
+
+	result.assembly = context->output;
+	result.assembly_length = sb_count(context->output);
+	return result;
+}
+
+foxc_cache_t* foxc_cache_open(const char* dir)
+{
+	return cache_open(dir);
+}
+
+void foxc_cache_close(foxc_cache_t* cache)
+{
+	cache_close(cache);
+}
@@ -0,0 +1,73 @@
+#ifndef _FOXC_H
+#define _FOXC_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+// Embeddable interface to the compiler.
+//
+// A context compiles C source held in memory into assembly held in memory,
+// and can be reused for any number of compilations. Errors in the source are
+// returned as a diagnostic rather than terminating the program.
+//
+// Separate contexts can be used from separate threads at the same time, but
+// a single context must only be used by one thread at a time.
+
+// An on-disk cache of generated functions, which can be shared by any number
+// of contexts and threads.
+typedef struct code_cache foxc_cache_t;
+
+// Options for a single compilation.
+typedef struct
+{
+	// Parse and generate one declaration at a time, rather than building the
+	// whole AST first. The generated assembly is the same either way.
+	bool stream;
+
+	// Cache to reuse the code of unchanged functions from, or NULL. The
+	// generated assembly is the same either way.
+	foxc_cache_t* cache;
+
+	// Encode the generated code straight into an ELF64 relocatable object,
+	// rather than producing assembly. The cache is not used.
+	bool object;
+
+	// Generate faster code, at some cost in compile time.
+	bool optimize;
+} foxc_options_t;
+
+// Outcome of a single compilation. Everything it points to belongs to the
+// context, and stays valid until the context is next used or destroyed.
+typedef struct
+{
+	bool ok;
+
+	// The generated assembly, which is NUL terminated. Empty on failure.
+	// When an object was asked for, this holds the bytes of the object.
+	const char* assembly;
+	size_t assembly_length;
+
+	// Description of the first error found, or NULL on success.
+	const char* diagnostic;
+} foxc_result_t;
+
+typedef struct foxc_context foxc_context_t;
+
+// Creates a new compiler context, returns NULL if out of memory.
+foxc_context_t* foxc_create();
+
+// Releases a context and the result of its last compilation.
+void foxc_destroy(foxc_context_t* context);
+
+// Compiles 'length' bytes of C source, which need not be NUL terminated.
+// If 'options' is NULL, the defaults are used.
+foxc_result_t foxc_compile(foxc_context_t* context, const char* source, size_t length, const foxc_options_t* options);
+
+// Opens the code cache held in the given directory, creating it if needed.
+// Returns NULL if the directory cannot be used.
+foxc_cache_t* foxc_cache_open(const char* dir);
+
+// Saves the functions added to the cache while it was open, and releases it.
+void foxc_cache_close(foxc_cache_t* cache);
+
+#endif
@@ -1,34 +1,176 @@
 #include "generator.h"
+#include "regalloc.h"
+#include "stats.h"
 
-typedef struct
+typedef struct var_map_entry
 {
 	str_t name;
-	int stack_offset;
+	var_location_t location;
+	int stack_offset; // VAR_STACK
+	reg_t reg;        // VAR_REGISTER
+	int32_t value;    // VAR_CONSTANT
 } var_map_entry_t;
 
-static struct
+static _Thread_local struct
 {
-	FILE* handle;
 	int label_counter;
 
 	var_map_entry_t* var_map;
 	int stack_index;
+
+	code_cache_t* cache;
+	bool optimize;
+	generate_entry_hook_t entry_hook;
+
+	// Set while generating a function of a session, whose variables live in
+	// the session's frame rather than on the stack.
+	bool session;
+
+	// Registers which hold the pending operand of a binary operator while the
+	// other is evaluated, those of 'all_scratch_registers' which the current
+	// function does not keep a variable in.
+	reg_t scratch_registers[16];
+	int scratch_register_count;
+
+	// Number of scratch registers currently holding an operand.
+	int scratch_count;
+
+	// Where each variable declared by the current function lives, in order of
+	// declaration, and the index of the next one to be declared. Stretchy
+	// buffer, its capacity is kept for the next function.
+	var_allocation_t* allocations;
+	int allocation_index;
+
+	// Callee-saved registers the current function keeps variables in, which
+	// it saves in its prologue and restores in its epilogue.
+	uint32_t saved_registers;
+
+	// Stretchy buffers receiving a function's output while it is captured
+	// for the cache, their capacity is kept for the next function.
+	char* capture_text;
+	emit_label_ref_t* capture_labels;
 } state;
 
-static char* new_label()
+// Registers which may hold the pending operand of a binary operator. They
+// are all caller-saved, and none of them is used by any single operation,
+// which only need %eax, %ecx and %edx.
+static const reg_t all_scratch_registers[] = { REG_SI, REG_DI, REG_R8, REG_R9, REG_R10, REG_R11 };
+
+// Registers which may hold a variable, in order of preference. Caller-saved
+// registers come first, as a function which uses only those has nothing to
+// save.
+static const reg_t variable_registers[] = {
+	REG_R8, REG_R9, REG_R10, REG_R11,
+	REG_BX, REG_R12, REG_R13, REG_R14, REG_R15
+};
+
+// Callee-saved registers among 'variable_registers', which are saved in the
+// prologue of the functions which use them, in this order.
+static const reg_t callee_saved_registers[] = { REG_BX, REG_R12, REG_R13, REG_R14, REG_R15 };
+
+#define ARRAY_COUNT(array) (int)(sizeof(array) / sizeof(array[0]))
+
+// Labels are plain integer ids, they are only formatted when emitted.
+static int new_label()
 {
-	char* buffer = malloc(64);
-	snprintf(buffer, 63, "_label%d", state.label_counter);
-	state.label_counter++;
-	return buffer;
+	STAT_INC(labels);
+	return state.label_counter++;
 }
 
-static void free_label(char* label)
+static void generate_expr(expr_t* expr);
+
+// Returns the index of the named variable in the map, or -1.
+static int find_var(str_t name)
 {
-	free(label);
+	for(int i = 0; i < sb_count(state.var_map); i++)
+	{
+		if(state.var_map[i].name == name)
+		{
+			return i;
+		}
+	}
+	return -1;
 }
 
-static void generate_expr(expr_t* expr);
+// Returns the named variable.
+// If the variable has not been declared, the program will terminate and an
+// error message will be printed to the user.
+static var_map_entry_t* declared_var(str_t name)
+{
+	int i = find_var(name);
+	if(i < 0)
+	{
+		error("'%s' undeclared\n", name);
+	}
+	return &state.var_map[i];
+}
+
+// Loads the value of the named variable into the given register.
+static void load_var(str_t name, reg_t reg)
+{
+	var_map_entry_t* var = declared_var(name);
+	switch(var->location)
+	{
+	case VAR_STACK: {
+		insn_load(var->stack_offset, reg);
+	} break;
+	case VAR_REGISTER: {
+		insn_mov(WIDTH_32, var->reg, reg);
+	} break;
+	case VAR_CONSTANT: {
+		insn_mov_imm(var->value, reg);
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+// Stores %eax into the named variable, which must not be a constant.
+static void store_var(str_t name)
+{
+	var_map_entry_t* var = declared_var(name);
+	switch(var->location)
+	{
+	case VAR_STACK: {
+		insn_store(REG_AX, var->stack_offset);
+	} break;
+	case VAR_REGISTER: {
+		insn_mov(WIDTH_32, REG_AX, var->reg);
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+// Returns the register holding the named variable, or REG_AX if it is not
+// kept in a register.
+static reg_t var_register(str_t name)
+{
+	var_map_entry_t* var = declared_var(name);
+	return var->location == VAR_REGISTER ? var->reg : REG_AX;
+}
+
+// Returns true if the expression is a literal or a variable, whose value can
+// be loaded into any register with a single instruction and no side effects.
+static bool is_leaf(expr_t* expr)
+{
+	return expr->type == EXPR_LITERAL || expr->type == EXPR_VAR;
+}
+
+// Loads the value of a leaf expression into the given register.
+static void generate_leaf(expr_t* expr, reg_t reg)
+{
+	if(expr->type == EXPR_LITERAL)
+	{
+		insn_mov_imm(expr->value, reg);
+	}
+	else
+	{
+		load_var(expr->var_name, reg);
+	}
+}
 
 static void generate_unary_expr(expr_t* expr)
 {
@@ -36,22 +178,454 @@ static void generate_unary_expr(expr_t* expr)
 	{
 	case UNARY_NEGATE: {
 		generate_expr(expr->unary_operand);
-		fprintf(state.handle, "\tneg %%eax\n");
+		insn_unary(UNARY_OP_NEG, REG_AX);
 	} break;
 	case UNARY_BITWISE_COMPLEMENT: {
 		generate_expr(expr->unary_operand);
-		fprintf(state.handle, "\tnot %%eax\n");
+		insn_unary(UNARY_OP_NOT, REG_AX);
 	} break;
 	case UNARY_LOGICAL_NEGATE: {
 		generate_expr(expr->unary_operand);
-		fprintf(state.handle, "\tcmpl $0, %%eax\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsete %%al\n");
+		insn_alu_imm(ALU_CMP, 0, REG_AX);
+		insn_mov_imm(0, REG_AX);
+		insn_setcc(COND_E, REG_AX);
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+// Labels the expression and each of its operands with the number of
+// registers needed to evaluate it without spilling (Sethi-Ullman numbering).
+// A binary operator whose operands need the same number of registers needs
+// one more, to hold the value of whichever is evaluated first. The operands
+// of a logical operator are evaluated one after the other, and neither is
+// held while the other is evaluated.
+static int label_registers(expr_t* expr)
+{
+	int registers = 1;
+	switch(expr->type)
+	{
+	case EXPR_LITERAL:
+	case EXPR_VAR: {
+	} break;
+	case EXPR_UNARY: {
+		registers = label_registers(expr->unary_operand);
+	} break;
+	case EXPR_BINARY: {
+		int lhs = label_registers(expr->binary_lhs);
+		int rhs = label_registers(expr->binary_rhs);
+		registers = lhs > rhs ? lhs : rhs;
+		if(lhs == rhs
+			&& expr->binary_operator != BINARY_LOGICAL_AND
+			&& expr->binary_operator != BINARY_LOGICAL_OR)
+		{
+			registers++;
+		}
+	} break;
+	case EXPR_ASSIGNMENT: {
+		registers = label_registers(expr->assign_rhs);
 	} break;
 	default: {
 		UNHANDLED_CASE();
 	} break;
 	}
+
+	expr->registers = registers;
+	return registers;
+}
+
+// Where 'generate_operands()' left the operands of a binary operator.
+typedef struct
+{
+	// Register holding the operand which is not in %eax, either %ecx, one of
+	// the scratch registers or the register of a variable.
+	reg_t other;
+
+	// Set if 'other' is a scratch register, to be released.
+	bool scratch;
+
+	// Set if %eax holds the right operand and 'other' the left one, rather
+	// than the other way round.
+	bool swapped;
+} operands_t;
+
+// Evaluates both operands of a binary operator, leaving one in %eax and the
+// other in a register, see 'operands_t'. Each call must be paired with
+// 'release_operands()' once the operation is done.
+// Without optimizing, the right operand is evaluated first and its value is
+// held on the stack while the left one is evaluated.
+// When optimizing, the operand which needs more registers is evaluated first,
+// and its value is held in a scratch register while the other one is
+// evaluated. Only when every scratch register is in use does it go through
+// the stack instead. On a tie the right operand goes first, leaving the left
+// one in %eax. An operand which is a leaf is loaded straight into %ecx
+// after the other one is evaluated, or used where it is if it is a variable
+// kept in a register. Leaves have no side effects, so they can be evaluated
+// out of order.
+static operands_t generate_operands(expr_t* expr)
+{
+	expr_t* lhs = expr->binary_lhs;
+	expr_t* rhs = expr->binary_rhs;
+	operands_t operands = { REG_CX, false, false };
+
+	expr_t* leaf = NULL;
+	if(state.optimize && is_leaf(rhs))
+	{
+		generate_expr(lhs);
+		leaf = rhs;
+	}
+	else if(state.optimize && is_leaf(lhs))
+	{
+		generate_expr(rhs);
+		leaf = lhs;
+		operands.swapped = true;
+	}
+	if(leaf)
+	{
+		if(leaf->type == EXPR_VAR && var_register(leaf->var_name) != REG_AX)
+		{
+			operands.other = var_register(leaf->var_name);
+		}
+		else
+		{
+			generate_leaf(leaf, REG_CX);
+		}
+		return operands;
+	}
+
+	expr_t* first = rhs;
+	expr_t* second = lhs;
+	if(!state.optimize)
+	{
+		generate_expr(first);
+		insn_push(REG_AX, NULL);
+		generate_expr(second);
+		insn_pop(REG_CX);
+		return operands;
+	}
+
+	if(lhs->registers > rhs->registers)
+	{
+		first = lhs;
+		second = rhs;
+		operands.swapped = true;
+	}
+
+	generate_expr(first);
+	if(state.scratch_count < state.scratch_register_count)
+	{
+		operands.other = state.scratch_registers[state.scratch_count++];
+		operands.scratch = true;
+		insn_mov(WIDTH_32, REG_AX, operands.other);
+		generate_expr(second);
+	}
+	else
+	{
+		STAT_INC(spills);
+		insn_push(REG_AX, NULL);
+		generate_expr(second);
+		insn_pop(REG_CX);
+	}
+	return operands;
+}
+
+// Makes the operands of a binary operator available for reuse.
+static void release_operands(operands_t operands)
+{
+	if(operands.scratch)
+	{
+		state.scratch_count--;
+	}
+}
+
+// Exchanges the operands if needed, so that the left one is in %eax. The
+// register of a variable is copied rather than exchanged, leaving the right
+// operand in %ecx.
+static void unswap_operands(operands_t* operands)
+{
+	if(!operands->swapped)
+	{
+		return;
+	}
+	if(operands->scratch || operands->other == REG_CX)
+	{
+		insn_xchg(operands->other);
+	}
+	else
+	{
+		insn_mov(WIDTH_32, REG_AX, REG_CX);
+		insn_mov(WIDTH_32, operands->other, REG_AX);
+		operands->other = REG_CX;
+	}
+	operands->swapped = false;
+}
+
+// Generates a commutative operation on the operands.
+static void generate_commutative(expr_t* expr, alu_op_t op)
+{
+	operands_t operands = generate_operands(expr);
+	insn_alu(op, operands.other, REG_AX);
+	release_operands(operands);
+}
+
+// Generates a comparison of the operands, producing 1 in %eax if the
+// condition holds and 0 otherwise.
+static void generate_comparison(expr_t* expr, cond_t cond)
+{
+	operands_t operands = generate_operands(expr);
+	if(operands.swapped)
+	{
+		insn_alu(ALU_CMP, REG_AX, operands.other);
+	}
+	else
+	{
+		insn_alu(ALU_CMP, operands.other, REG_AX);
+	}
+	insn_mov_imm(0, REG_AX);
+	insn_setcc(cond, REG_AX);
+	release_operands(operands);
+}
+
+// Generates a shift of the left operand by the right one, which has to be
+// in %cl.
+static void generate_shift(expr_t* expr, shift_op_t op)
+{
+	operands_t operands = generate_operands(expr);
+	unswap_operands(&operands);
+	if(operands.other != REG_CX)
+	{
+		insn_mov(WIDTH_32, operands.other, REG_CX);
+	}
+	insn_shift_cl(op, REG_AX);
+	release_operands(operands);
+}
+
+// Divides the left operand by the right with 'idivl', leaving the quotient
+// in %eax and the remainder in %edx.
+static void generate_idiv(expr_t* expr)
+{
+	operands_t operands = generate_operands(expr);
+	unswap_operands(&operands);
+	insn_cdq();
+	insn_idiv(operands.other);
+	release_operands(operands);
+}
+
+// Returns k if the value is exactly 2^k, otherwise -1.
+static int exact_log2(uint32_t value)
+{
+	if(value == 0 || (value & (value - 1)) != 0)
+	{
+		return -1;
+	}
+	return __builtin_ctz(value);
+}
+
+// Multiplies by a constant operand with a shift or 'lea' where one will do,
+// leaving the product in %eax. Returns false, having generated nothing, if
+// neither operand is such a constant.
+static bool generate_constant_multiply(expr_t* expr)
+{
+	expr_t* operand = expr->binary_lhs;
+	expr_t* constant = expr->binary_rhs;
+	if(operand->type == EXPR_LITERAL)
+	{
+		operand = expr->binary_rhs;
+		constant = expr->binary_lhs;
+	}
+	if(constant->type != EXPR_LITERAL)
+	{
+		return false;
+	}
+
+	int32_t value = (int32_t)constant->value;
+	int shift = exact_log2((uint32_t)value);
+	if(shift > 0)
+	{
+		generate_expr(operand);
+		insn_shift_imm(SHIFT_SAL, shift, REG_AX);
+		return true;
+	}
+	if(value == 3 || value == 5 || value == 9)
+	{
+		generate_expr(operand);
+		insn_lea(REG_AX, REG_AX, value - 1, REG_AX);
+		return true;
+	}
+	return false;
+}
+
+typedef struct
+{
+	int32_t multiplier;
+	int shift;
+} magic_t;
+
+// Finds the multiplier and shift with which the high half of a signed
+// multiplication divides by the given constant, whose magnitude must be at
+// least two, see Hacker's Delight, section 10-4.
+static magic_t magic_divisor(int32_t divisor)
+{
+	const uint32_t two31 = 0x80000000u;
+	uint32_t magnitude = divisor < 0 ? 0u - (uint32_t)divisor : (uint32_t)divisor;
+	uint32_t t = two31 + ((uint32_t)divisor >> 31);
+	uint32_t nc = t - 1 - t % magnitude;
+
+	// 2^p / nc and 2^p / |d|, along with their remainders, for increasing p
+	// until 2^p exceeds nc * (|d| - 2^p % |d|).
+	int p = 31;
+	uint32_t q1 = two31 / nc;
+	uint32_t r1 = two31 - q1 * nc;
+	uint32_t q2 = two31 / magnitude;
+	uint32_t r2 = two31 - q2 * magnitude;
+	uint32_t delta;
+	do
+	{
+		p++;
+		q1 *= 2;
+		r1 *= 2;
+		if(r1 >= nc)
+		{
+			q1++;
+			r1 -= nc;
+		}
+		q2 *= 2;
+		r2 *= 2;
+		if(r2 >= magnitude)
+		{
+			q2++;
+			r2 -= magnitude;
+		}
+		delta = magnitude - r2;
+	} while(q1 < delta || (q1 == delta && r1 == 0));
+
+	magic_t magic;
+	magic.multiplier = (int32_t)(q2 + 1);
+	if(divisor < 0)
+	{
+		magic.multiplier = -magic.multiplier;
+	}
+	magic.shift = p - 32;
+	return magic;
+}
+
+// Divides %eax by a constant, which must not be zero, leaving the quotient
+// rounded toward zero in %eax, as 'idivl' would. Unless the magnitude of the
+// divisor is a power of two, the dividend is also left in %ecx.
+static void generate_constant_quotient(int32_t divisor)
+{
+	uint32_t magnitude = divisor < 0 ? 0u - (uint32_t)divisor : (uint32_t)divisor;
+	int shift = exact_log2(magnitude);
+	if(shift == 0)
+	{
+		if(divisor < 0)
+		{
+			insn_unary(UNARY_OP_NEG, REG_AX);
+		}
+		return;
+	}
+
+	if(shift > 0)
+	{
+		// A negative dividend is biased by 2^k - 1, so that the shift rounds
+		// it toward zero rather than down.
+		insn_cdq();
+		insn_shift_imm(SHIFT_SHR, 32 - shift, REG_DX);
+		insn_alu(ALU_ADD, REG_DX, REG_AX);
+		insn_shift_imm(SHIFT_SAR, shift, REG_AX);
+		if(divisor < 0)
+		{
+			insn_unary(UNARY_OP_NEG, REG_AX);
+		}
+		return;
+	}
+
+	magic_t magic = magic_divisor(divisor);
+	insn_mov(WIDTH_32, REG_AX, REG_CX);
+	insn_mov_imm(magic.multiplier, REG_DX);
+	insn_imul_wide(REG_DX);
+
+	// The multiplier is a 33-bit value when its sign differs from that of
+	// the divisor, the dividend makes up the difference.
+	if(divisor > 0 && magic.multiplier < 0)
+	{
+		insn_alu(ALU_ADD, REG_CX, REG_DX);
+	}
+	else if(divisor < 0 && magic.multiplier > 0)
+	{
+		insn_alu(ALU_SUB, REG_CX, REG_DX);
+	}
+	if(magic.shift > 0)
+	{
+		insn_shift_imm(SHIFT_SAR, magic.shift, REG_DX);
+	}
+
+	// Adding one to a negative quotient rounds it toward zero.
+	insn_mov(WIDTH_32, REG_DX, REG_AX);
+	insn_shift_imm(SHIFT_SHR, 31, REG_AX);
+	insn_alu(ALU_ADD, REG_DX, REG_AX);
+}
+
+// Divides by a nonzero constant without 'idivl', leaving the quotient in
+// %eax. Returns false, having generated nothing, for any other divisor.
+static bool generate_constant_division(expr_t* expr)
+{
+	expr_t* divisor = expr->binary_rhs;
+	if(divisor->type != EXPR_LITERAL || (int32_t)divisor->value == 0)
+	{
+		return false;
+	}
+
+	generate_expr(expr->binary_lhs);
+	generate_constant_quotient((int32_t)divisor->value);
+	return true;
+}
+
+// Computes the remainder of a division by a nonzero constant without
+// 'idivl', leaving it in %eax. Returns false, having generated nothing, for
+// any other divisor.
+static bool generate_constant_modulo(expr_t* expr)
+{
+	expr_t* divisor = expr->binary_rhs;
+	if(divisor->type != EXPR_LITERAL || (int32_t)divisor->value == 0)
+	{
+		return false;
+	}
+
+	// The remainder takes the sign of the dividend, so only the magnitude of
+	// the divisor matters.
+	int32_t value = (int32_t)divisor->value;
+	uint32_t magnitude = value < 0 ? 0u - (uint32_t)value : (uint32_t)value;
+	int shift = exact_log2(magnitude);
+
+	generate_expr(expr->binary_lhs);
+	if(shift == 0)
+	{
+		insn_mov_imm(0, REG_AX);
+		return true;
+	}
+
+	if(shift > 0)
+	{
+		// A negative dividend is biased by 2^k - 1 before masking and the bias
+		// is taken off again afterwards, so that the remainder is negative too.
+		insn_cdq();
+		insn_shift_imm(SHIFT_SHR, 32 - shift, REG_DX);
+		insn_alu(ALU_ADD, REG_DX, REG_AX);
+		insn_alu_imm(ALU_AND, (int32_t)(magnitude - 1), REG_AX);
+		insn_alu(ALU_SUB, REG_DX, REG_AX);
+		return true;
+	}
+
+	// n % d is n - (n / d) * d.
+	generate_constant_quotient(value);
+	insn_mov_imm(value, REG_DX);
+	insn_alu(ALU_IMUL, REG_DX, REG_AX);
+	insn_alu(ALU_SUB, REG_AX, REG_CX);
+	insn_mov(WIDTH_32, REG_CX, REG_AX);
+	return true;
 }
 
 static void generate_binary_expr(expr_t* expr)
@@ -59,166 +633,107 @@ static void generate_binary_expr(expr_t* expr)
 	switch(expr->binary_operator)
 	{
 	case BINARY_ADD: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\taddl %%ecx, %%eax\n");
+		generate_commutative(expr, ALU_ADD);
 	} break;
 	case BINARY_SUB: {
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tsubl %%ecx, %%eax\n");
+		// With the right operand in %eax, 'lhs - rhs' is '-rhs + lhs'.
+		operands_t operands = generate_operands(expr);
+		if(operands.swapped)
+		{
+			insn_unary(UNARY_OP_NEG, REG_AX);
+			insn_alu(ALU_ADD, operands.other, REG_AX);
+		}
+		else
+		{
+			insn_alu(ALU_SUB, operands.other, REG_AX);
+		}
+		release_operands(operands);
 	} break;
 	case BINARY_MUL: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\timul %%ecx, %%eax\n");
+		if(generate_constant_multiply(expr))
+		{
+			break;
+		}
+		generate_commutative(expr, ALU_IMUL);
 	} break;
 	case BINARY_LESS: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tcmpl %%eax, %%ecx\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsetl %%al\n");
+		generate_comparison(expr, COND_L);
 	} break;
 	case BINARY_LESS_EQ: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tcmpl %%eax, %%ecx\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsetle %%al\n");
+		generate_comparison(expr, COND_LE);
 	} break;
 	case BINARY_GRTR: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tcmpl %%eax, %%ecx\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsetg %%al\n");
+		generate_comparison(expr, COND_G);
 	} break;
 	case BINARY_GRTR_EQ: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tcmpl %%eax, %%ecx\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsetge %%al\n");
+		generate_comparison(expr, COND_GE);
 	} break;
 	case BINARY_DIV: {
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tmovl %%eax, %%ebx\n");
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\txor %%edx, %%edx\n");
-		fprintf(state.handle, "\tidivl %%ebx\n");
+		if(generate_constant_division(expr))
+		{
+			break;
+		}
+		generate_idiv(expr);
 	} break;
 	case BINARY_EQUALS: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tcmpl %%eax, %%ecx\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsete %%al\n");
+		generate_comparison(expr, COND_E);
 	} break;
 	case BINARY_NOT_EQ: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tcmpl %%eax, %%ecx\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsetne %%al\n");
+		generate_comparison(expr, COND_NE);
 	} break;
 	case BINARY_LOGICAL_AND: {
-		char* l1 = new_label();
-		char* l2 = new_label();
+		int l1 = new_label();
+		int l2 = new_label();
 
 		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tcmpl $0, %%eax\n");
-		fprintf(state.handle, "\tjne %s\n", l1);
-		fprintf(state.handle, "\tjmp %s\n", l2);
-		fprintf(state.handle, "%s:\n", l1);
+		insn_alu_imm(ALU_CMP, 0, REG_AX);
+		insn_jump(COND_NE, l1);
+		insn_jump(COND_ALWAYS, l2);
+		insn_label(l1);
 		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tcmpl $0, %%eax\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsetne %%al\n");
-		fprintf(state.handle, "%s:\n", l2);
-
-		free_label(l1);
-		free_label(l2);
+		insn_alu_imm(ALU_CMP, 0, REG_AX);
+		insn_mov_imm(0, REG_AX);
+		insn_setcc(COND_NE, REG_AX);
+		insn_label(l2);
 	} break;
 	case BINARY_LOGICAL_OR: {
-		char* l1 = new_label();
-		char* l2 = new_label();
+		int l1 = new_label();
+		int l2 = new_label();
 
 		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tcmpl $0, %%eax\n");
-		fprintf(state.handle, "\tje %s\n", l1);
-		fprintf(state.handle, "\tmovl $1, %%eax\n");
-		fprintf(state.handle, "\tjmp %s\n", l2);
-		fprintf(state.handle, "%s:\n", l1);
+		insn_alu_imm(ALU_CMP, 0, REG_AX);
+		insn_jump(COND_E, l1);
+		insn_mov_imm(1, REG_AX);
+		insn_jump(COND_ALWAYS, l2);
+		insn_label(l1);
 		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tcmpl $0, %%eax\n");
-		fprintf(state.handle, "\tmovl $0, %%eax\n");
-		fprintf(state.handle, "\tsetne %%al\n");
-		fprintf(state.handle, "%s:\n", l2);
-
-		free_label(l1);
-		free_label(l2);
+		insn_alu_imm(ALU_CMP, 0, REG_AX);
+		insn_mov_imm(0, REG_AX);
+		insn_setcc(COND_NE, REG_AX);
+		insn_label(l2);
 	} break;
 	case BINARY_MODULO: {
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tmovl %%eax, %%ebx\n");
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\txor %%edx, %%edx\n");
-		fprintf(state.handle, "\tidivl %%ebx\n");
-		fprintf(state.handle, "\tmovl %%edx, %%eax\n");
+		if(generate_constant_modulo(expr))
+		{
+			break;
+		}
+		generate_idiv(expr);
+		insn_mov(WIDTH_32, REG_DX, REG_AX);
 	} break;
 	case BINARY_BITWISE_AND: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tand %%ecx, %%eax\n");
+		generate_commutative(expr, ALU_AND);
 	} break;
 	case BINARY_BITWISE_OR: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tor %%ecx, %%eax\n");
+		generate_commutative(expr, ALU_OR);
 	} break;
 	case BINARY_BITWISE_XOR: {
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\txor %%ecx, %%eax\n");
+		generate_commutative(expr, ALU_XOR);
 	} break;
 	case BINARY_SHIFT_LEFT: {
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tsal %%cl, %%eax\n");
+		generate_shift(expr, SHIFT_SAL);
 	} break;
 	case BINARY_SHIFT_RIGHT: {
-		generate_expr(expr->binary_rhs);
-		fprintf(state.handle, "\tpush %%rax\n");
-		generate_expr(expr->binary_lhs);
-		fprintf(state.handle, "\tpop %%rcx\n");
-		fprintf(state.handle, "\tsar %%cl, %%eax\n");
+		generate_shift(expr, SHIFT_SAR);
 	} break;
 	default: {
 		UNHANDLED_CASE();
@@ -231,7 +746,7 @@ static void generate_expr(expr_t* expr)
 	switch(expr->type)
 	{
 	case EXPR_LITERAL: {
-		fprintf(state.handle, "\tmovl $%ld, %%eax\n", expr->value);
+		insn_mov_imm(expr->value, REG_AX);
 	} break;
 	case EXPR_UNARY: {
 		generate_unary_expr(expr);
@@ -240,32 +755,11 @@ static void generate_expr(expr_t* expr)
 		generate_binary_expr(expr);
 	} break;
 	case EXPR_VAR: {
-		int offset = 0;
-		for(int i = 0; i < sb_count(state.var_map); i++)
-		{
-			if(state.var_map[i].name == expr->var_name)
-			{
-				offset = state.var_map[i].stack_offset;
-				break;
-			}
-		}
-
-		fprintf(state.handle, "\tmovl %d(%%rbp), %%eax\n", offset);
+		load_var(expr->var_name, REG_AX);
 	} break;
 	case EXPR_ASSIGNMENT: {
 		generate_expr(expr->assign_rhs);
-
-		int offset = 0;
-		for(int i = 0; i < sb_count(state.var_map); i++)
-		{
-			if(state.var_map[i].name == expr->var_name)
-			{
-				offset = state.var_map[i].stack_offset;
-				break;
-			}
-		}
-
-		fprintf(state.handle, "\tmovl %%eax, %d(%%rbp)\n", offset);
+		store_var(expr->var_name);
 	} break;
 	default: {
 		UNHANDLED_CASE();
@@ -273,33 +767,132 @@ static void generate_expr(expr_t* expr)
 	}
 }
 
+// Generates an expression which is not part of another, leaving its value in
+// %eax.
+static void generate_full_expr(expr_t* expr)
+{
+	if(state.optimize)
+	{
+		label_registers(expr);
+	}
+	generate_expr(expr);
+}
+
+static void generate_epilogue()
+{
+	// The frame of a session function is not on the stack, and the stack
+	// pointer is back where the prologue left it at every statement.
+	if(state.session)
+	{
+		insn_pop(REG_BP);
+		insn_ret();
+		return;
+	}
+
+	insn_mov(WIDTH_64, REG_BP, REG_SP);
+	insn_pop(REG_BP);
+	for(int i = ARRAY_COUNT(callee_saved_registers) - 1; i >= 0; i--)
+	{
+		if(state.saved_registers & (1u << callee_saved_registers[i]))
+		{
+			insn_pop(callee_saved_registers[i]);
+		}
+	}
+	insn_ret();
+}
+
+// Declares a variable in the frame of a session. Declaring a variable again
+// gives it a new value, rather than a new slot.
+static void generate_session_declaration(stmt_t* stmt)
+{
+	if(stmt->declare_initializer)
+	{
+		generate_full_expr(stmt->declare_initializer);
+	}
+
+	int i = find_var(stmt->declare_name);
+	if(i < 0)
+	{
+		state.stack_index -= 8;
+
+		var_map_entry_t new_var_entry = { 0 };
+		new_var_entry.name = stmt->declare_name;
+		new_var_entry.location = VAR_STACK;
+		new_var_entry.stack_offset = state.stack_index;
+		sb_push(state.var_map, new_var_entry);
+		i = sb_count(state.var_map) - 1;
+	}
+
+	if(stmt->declare_initializer)
+	{
+		insn_store(REG_AX, state.var_map[i].stack_offset);
+	}
+}
+
 static void generate_stmt(stmt_t* stmt)
 {
 	switch(stmt->type)
 	{
 	case STMT_RETURN: {
-		generate_expr(stmt->return_expr);
-
-		// Function Epilogue
-		fprintf(state.handle, "\tmov %%rbp, %%rsp\n");
-		fprintf(state.handle, "\tpop %%rbp\n");
-		fprintf(state.handle, "\tret\n");
+		generate_full_expr(stmt->return_expr);
+		generate_epilogue();
 	} break;
 	case STMT_EXPR: {
-		generate_expr(stmt->standalone_expr);
+		generate_full_expr(stmt->standalone_expr);
 	} break;
 	case STMT_DECLARE: {
+		if(state.session)
+		{
+			generate_session_declaration(stmt);
+			break;
+		}
+
+		// Without optimizing, every variable lives on the stack.
+		var_allocation_t allocation = { VAR_STACK };
+		if(state.optimize)
+		{
+			allocation = state.allocations[state.allocation_index++];
+		}
+
+		var_map_entry_t new_var_entry = { 0 };
+		new_var_entry.name = stmt->declare_name;
+		new_var_entry.location = allocation.location;
+
+		// A constant is only ever initialized with a literal, which it is
+		// rematerialized from wherever it is used.
+		if(allocation.location == VAR_CONSTANT)
+		{
+			new_var_entry.value = allocation.value;
+			sb_push(state.var_map, new_var_entry);
+			break;
+		}
+
+		expr_t* initializer = stmt->declare_initializer;
+		if(allocation.location == VAR_REGISTER)
+		{
+			if(initializer && initializer->type == EXPR_LITERAL)
+			{
+				insn_mov_imm(initializer->value, allocation.reg);
+			}
+			else if(initializer)
+			{
+				generate_full_expr(initializer);
+				insn_mov(WIDTH_32, REG_AX, allocation.reg);
+			}
+			new_var_entry.reg = allocation.reg;
+			sb_push(state.var_map, new_var_entry);
+			break;
+		}
+
 		// if(var_exists(stmt->var_name)) ...
-		if(stmt->declare_initializer)
+		if(initializer)
 		{
-			generate_expr(stmt->declare_initializer);
+			generate_full_expr(initializer);
 		}
-		fprintf(state.handle, "\tpush %%rax # %s\n", stmt->declare_name);
+		insn_push(REG_AX, stmt->declare_name);
 
 		state.stack_index -= 8; // TODO: calculate size of pushed value automatically
 
-		var_map_entry_t new_var_entry;
-		new_var_entry.name = stmt->declare_name;
 		new_var_entry.stack_offset = state.stack_index;
 
 		sb_push(state.var_map, new_var_entry);
@@ -310,27 +903,160 @@ static void generate_stmt(stmt_t* stmt)
 	}
 }
 
+// Makes every scratch register which does not hold a variable available.
+static void reset_scratch_registers(uint32_t variable_registers_used)
+{
+	state.scratch_register_count = 0;
+	for(int i = 0; i < ARRAY_COUNT(all_scratch_registers); i++)
+	{
+		if(!(variable_registers_used & (1u << all_scratch_registers[i])))
+		{
+			state.scratch_registers[state.scratch_register_count++] = all_scratch_registers[i];
+		}
+	}
+	state.scratch_count = 0;
+}
+
+static void generate_function(decl_t* decl)
+{
+	// Each function starts with an empty stack frame, and with every scratch
+	// register free, even if the previous function was abandoned by an error.
+	sb_free(state.var_map);
+	state.var_map = NULL;
+	state.stack_index = 0;
+
+	uint32_t used = 0;
+	if(state.optimize)
+	{
+		used = regalloc_function(decl, variable_registers, ARRAY_COUNT(variable_registers), &state.allocations);
+	}
+	state.allocation_index = 0;
+	reset_scratch_registers(used);
+
+	state.saved_registers = 0;
+	for(int i = 0; i < ARRAY_COUNT(callee_saved_registers); i++)
+	{
+		state.saved_registers |= used & (1u << callee_saved_registers[i]);
+	}
+
+	insn_function(decl->name);
+	if(state.entry_hook)
+	{
+		state.entry_hook(decl);
+	}
+	
+	// Function Prologue
+	for(int i = 0; i < ARRAY_COUNT(callee_saved_registers); i++)
+	{
+		if(state.saved_registers & (1u << callee_saved_registers[i]))
+		{
+			insn_push(callee_saved_registers[i], NULL);
+		}
+	}
+	insn_push(REG_BP, NULL);
+	insn_mov(WIDTH_64, REG_SP, REG_BP);
+	
+	for(int i = 0; i < decl->stmt_count; i++)
+	{
+		generate_stmt(decl->stmts[i]);
+	}
+
+	// Falling off the end returns zero, as 'main' does, and as in the VM.
+	if(decl->stmt_count == 0 || decl->stmts[decl->stmt_count - 1]->type != STMT_RETURN)
+	{
+		insn_mov_imm(0, REG_AX);
+	}
+	generate_epilogue();
+}
+
+// Returns the cache key for the given function. A function's code depends
+// only on its own tokens, on the generator itself and on whether it is
+// optimizing.
+static uint64_t cache_key(decl_t* decl)
+{
+	uint64_t key = decl->token_hash ^ GENERATOR_VERSION ^ (state.optimize ? 0x9e3779b97f4a7c15ull : 0);
+	key ^= key >> 33;
+	key *= 0xff51afd7ed558ccdull;
+	key ^= key >> 33;
+	return key;
+}
+
+// Emits a function from the cache, giving its labels ids following on from
+// those already used.
+static void splice_function(cache_entry_t* entry)
+{
+	int base = state.label_counter;
+	uint32_t offset = 0;
+	for(uint32_t i = 0; i < entry->label_ref_count; i++)
+	{
+		const emit_label_ref_t* ref = &entry->labels[i];
+		emit_bytes(entry->text + offset, ref->offset - offset);
+		emit_label(base + ref->label);
+		offset = ref->offset;
+	}
+	emit_bytes(entry->text + offset, entry->text_length - offset);
+
+	state.label_counter += entry->label_count;
+	stats.labels += entry->label_count;
+}
+
+// Generates a function, reusing its code from the cache if it is there and
+// adding it to the cache otherwise.
+static void generate_cached_function(decl_t* decl)
+{
+	uint64_t key = cache_key(decl);
+
+	cache_entry_t entry;
+	if(cache_lookup(state.cache, key, &entry))
+	{
+		STAT_INC(cache_hits);
+		splice_function(&entry);
+		return;
+	}
+	STAT_INC(cache_misses);
+
+	if(state.capture_text)
+	{
+		stb__sbn(state.capture_text) = 0;
+	}
+	if(state.capture_labels)
+	{
+		stb__sbn(state.capture_labels) = 0;
+	}
+
+	int base = state.label_counter;
+	emit_capture_begin(&state.capture_text, &state.capture_labels);
+	generate_function(decl);
+	emit_capture_end();
+
+	// Labels are stored relative to the first one the function used.
+	for(int i = 0; i < sb_count(state.capture_labels); i++)
+	{
+		state.capture_labels[i].label -= base;
+	}
+
+	entry.text = state.capture_text;
+	entry.text_length = sb_count(state.capture_text);
+	entry.labels = state.capture_labels;
+	entry.label_ref_count = sb_count(state.capture_labels);
+	entry.label_count = state.label_counter - base;
+	cache_insert(state.cache, key, &entry);
+}
+
 static void generate_decl(decl_t* decl)
 {
 	switch(decl->type)
 	{
 	case DECL_FUNC: {
-		fprintf(state.handle, ".globl %s\n", decl->name);
-		fprintf(state.handle, "%s:\n", decl->name);
-		
-		// Function Prologue
-		fprintf(state.handle, "\tpush %%rbp\n");
-		fprintf(state.handle, "\tmov %%rsp, %%rbp\n");
-		
-		for(int i = 0; i < sb_count(decl->stmts); i++)
+		// Only assembly text is cached, and instrumented functions never are.
+		if(state.cache && insn_target() == TARGET_ASSEMBLY && state.entry_hook == NULL)
 		{
-			generate_stmt(decl->stmts[i]);
+			generate_cached_function(decl);
+		}
+		else
+		{
+			generate_function(decl);
 		}
-		
-		// Function Epilogue
-		fprintf(state.handle, "\tmov %%rbp, %%rsp\n");
-		fprintf(state.handle, "\tpop %%rbp\n");
-		fprintf(state.handle, "\tret\n");
 	} break;
 	default: {
 		UNHANDLED_CASE();
@@ -340,15 +1066,100 @@ static void generate_decl(decl_t* decl)
 
 static void generate_program(program_t* program)
 {
-	generate_decl(program->decl);
+	for(int i = 0; i < program->decl_count; i++)
+	{
+		generate_decl(program->decls[i]);
+	}
+}
+
+void generate(program_t* program)
+{
+	generate_begin();
+	generate_program(program);
+	generate_end();
 }
 
-void generate(FILE* handle, program_t* program)
+void generate_begin()
 {
-	state.handle = handle;
 	state.label_counter = 0;
-	state.var_map = NULL;
 	state.stack_index = 0;
+	state.session = false;
+	state.saved_registers = 0;
+	reset_scratch_registers(0);
 
-	generate_program(program);
+	// Generation which was abandoned by an error never reached
+	// 'generate_end()'.
+	sb_free(state.var_map);
+	state.var_map = NULL;
+}
+
+void generate_declaration(decl_t* decl)
+{
+	generate_decl(decl);
+}
+
+void generate_set_cache(code_cache_t* cache)
+{
+	state.cache = cache;
+}
+
+void generate_session_function(generate_session_t* session, decl_t* decl)
+{
+	generate_begin();
+
+	// Generation works on a copy of the variables, so that an error part way
+	// through leaves the session as it was.
+	for(int i = 0; i < sb_count(session->vars); i++)
+	{
+		sb_push(state.var_map, session->vars[i]);
+	}
+	state.stack_index = -session->frame_size;
+	state.session = true;
+
+	insn_function(decl->name);
+	insn_push(REG_BP, NULL);
+	insn_mov(WIDTH_64, REG_DI, REG_BP);
+
+	for(int i = 0; i < decl->stmt_count; i++)
+	{
+		generate_stmt(decl->stmts[i]);
+	}
+
+	generate_epilogue();
+	state.session = false;
+
+	sb_free(session->vars);
+	session->vars = state.var_map;
+	session->frame_size = -state.stack_index;
+	state.var_map = NULL;
+}
+
+void generate_session_free(generate_session_t* session)
+{
+	sb_free(session->vars);
+	session->vars = NULL;
+	session->frame_size = 0;
+}
+
+void generate_set_optimize(bool optimize)
+{
+	state.optimize = optimize;
+}
+
+bool generate_optimize()
+{
+	return state.optimize;
+}
+
+void generate_set_entry_hook(generate_entry_hook_t hook)
+{
+	state.entry_hook = hook;
+}
+
+void generate_end()
+{
+	sb_free(state.var_map);
+	state.var_map = NULL;
+	sb_free(state.allocations);
+	state.allocations = NULL;
 }
\ No newline at end of file
@@ -1,11 +1,80 @@
 #ifndef _GENERATOR_H
 #define _GENERATOR_H
 
-#include <stdio.h>
-
 #include "parser.h"
 #include "buf.h"
+#include "emitter.h"
+#include "cache.h"
+#include "insn.h"
+
+// Identifies the code the generator produces, and is part of every cache
+// key. It must be bumped whenever the assembly generated for some function
+// changes, so that stale entries are not reused.
+#define GENERATOR_VERSION 9
+
+// Generates assembly for the given program.
+// Output goes to the emitter, which the caller must have started with
+// 'emit_begin()' or 'emit_begin_memory()', or to the object started with
+// 'object_begin()' if the target is TARGET_OBJECT, see 'insn_set_target()'.
+void generate(program_t* program);
+
+// Begins generating assembly one declaration at a time.
+void generate_begin();
+
+// Generates assembly for a single declaration.
+void generate_declaration(decl_t* decl);
+
+// Variables kept from one function to the next, so that a sequence of
+// statements can be generated and run one at a time, as in a REPL.
+// The variables live in a frame belonging to the caller, rather than on the
+// stack, and each function of the session is given the address just past the
+// end of the frame as its only argument.
+typedef struct
+{
+	// Variables declared so far, private to the generator.
+	struct var_map_entry* vars;
+
+	// Number of bytes at the end of the frame used by the variables.
+	int frame_size;
+} generate_session_t;
+
+// Generates a function which runs the statements of 'decl' in the session,
+// returning the value left by its last statement. Variables declared by the
+// statements are added to the session. The session is only updated if the
+// function was generated without error.
+void generate_session_function(generate_session_t* session, decl_t* decl);
+
+// Releases the variables of a session, leaving it empty.
+void generate_session_free(generate_session_t* session);
+
+// Sets the cache that functions generated on the calling thread are looked
+// up in and added to, or disables caching when given NULL.
+// Output is the same with or without a cache.
+void generate_set_cache(code_cache_t* cache);
+
+// Enables or disables optimization of the code generated on the calling
+// thread. Optimized code takes longer to generate but runs faster: it keeps
+// variables in registers, and evaluates the operand which needs more
+// registers first. Unoptimized code keeps every variable on the stack, and
+// holds the right operand of a binary operator there while the left one is
+// evaluated.
+void generate_set_optimize(bool optimize);
+
+// Returns whether code generated on the calling thread is optimized.
+bool generate_optimize();
+
+// Called at the entry of every function generated on the calling thread,
+// after its symbol is defined and before its prologue. It may add code of
+// its own, which must leave the stack and every callee-saved register as it
+// found them.
+typedef void (*generate_entry_hook_t)(decl_t* decl);
+
+// Sets the hook called at the entry of every function, or removes it when
+// given NULL. Functions are not cached while a hook is set.
+void generate_set_entry_hook(generate_entry_hook_t hook);
 
-void generate(FILE* handle, program_t* program);
+// Finishes generation started with 'generate_begin()'. The caller is still
+// responsible for calling 'emit_end()'.
+void generate_end();
 
 #endif
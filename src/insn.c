@@ -0,0 +1,527 @@
+#include <stdbool.h>
+#include <string.h>
+
+#include "insn.h"
+#include "object.h"
+#include "error.h"
+#include "stats.h"
+
+static _Thread_local struct
+{
+	target_t target;
+} state;
+
+// AT&T mnemonics of the two operand operations, indexed by 'alu_op_t'.
+static const char* const alu_names[] =
+{
+	[ALU_ADD]  = "addl",
+	[ALU_OR]   = "or",
+	[ALU_AND]  = "and",
+	[ALU_SUB]  = "subl",
+	[ALU_XOR]  = "xor",
+	[ALU_CMP]  = "cmpl",
+	[ALU_IMUL] = "imul"
+};
+
+static const char* const unary_names[] =
+{
+	[UNARY_OP_NOT] = "not",
+	[UNARY_OP_NEG] = "neg"
+};
+
+static const char* const shift_names[] =
+{
+	[SHIFT_SAL] = "sal",
+	[SHIFT_SHR] = "shr",
+	[SHIFT_SAR] = "sar"
+};
+
+// Condition suffixes, indexed by 'cond_t'.
+static const char* const cond_names[] =
+{
+	[COND_E]      = "e",
+	[COND_NE]     = "ne",
+	[COND_L]      = "l",
+	[COND_GE]     = "ge",
+	[COND_LE]     = "le",
+	[COND_G]      = "g",
+	[COND_ALWAYS] = "mp"
+};
+
+// Records an instruction in the statistics, given its mnemonic.
+static inline void count_insn(const char* mnemonic)
+{
+	if(stats.enabled)
+	{
+		stats_count_insn(mnemonic);
+	}
+}
+
+//
+// Assembly output.
+//
+
+// Emits the mnemonic of an instruction, along with the leading tab and the
+// separating space.
+static void text_mnemonic(const char* mnemonic)
+{
+	emit_char('\t');
+	emit_str(mnemonic);
+	emit_char(' ');
+}
+
+// Emits 'offset(%rbp)'.
+static void text_frame_slot(int32_t offset)
+{
+	emit_int(offset);
+	emit_lit("(%rbp)");
+}
+
+//
+// Machine code output.
+//
+
+#define REX   0x40
+#define REX_W 0x08
+#define REX_R 0x04
+#define REX_X 0x02
+#define REX_B 0x01
+
+// Emits a REX prefix if any of its bits are needed. Byte registers beyond
+// %bl are only reachable with a prefix, even one with no bits set.
+static void code_rex(int bits, reg_t reg, reg_t rm, width_t width)
+{
+	if(reg >= REG_R8) bits |= REX_R;
+	if(rm >= REG_R8)  bits |= REX_B;
+
+	bool byte_reg = width == WIDTH_8 && ((reg >= REG_SP && reg < REG_R8) || (rm >= REG_SP && rm < REG_R8));
+	if(bits || byte_reg)
+	{
+		object_byte(REX | bits);
+	}
+}
+
+// Emits an instruction whose ModRM byte addresses a register directly.
+// 'reg' is either a register or an opcode extension.
+static void code_rr(const char* opcode, int opcode_length, width_t width, int reg, reg_t rm)
+{
+	code_rex(width == WIDTH_64 ? REX_W : 0, reg, rm, width);
+	object_bytes(opcode, opcode_length);
+	object_byte(0xc0 | (reg & 7) << 3 | (rm & 7));
+}
+
+// Emits a 32-bit instruction whose ModRM byte addresses 'offset(%rbp)'.
+static void code_frame_slot(uint8_t opcode, reg_t reg, int32_t offset)
+{
+	code_rex(0, reg, REG_BP, WIDTH_32);
+	object_byte(opcode);
+	if(offset >= INT8_MIN && offset <= INT8_MAX)
+	{
+		object_byte(0x40 | (reg & 7) << 3 | REG_BP);
+		object_byte((int8_t)offset);
+	}
+	else
+	{
+		object_byte(0x80 | (reg & 7) << 3 | REG_BP);
+		object_imm32(offset);
+	}
+}
+
+// Emits an instruction which is a single opcode plus a register number.
+static void code_short_reg(uint8_t opcode, reg_t reg)
+{
+	code_rex(0, 0, reg, WIDTH_32);
+	object_byte(opcode + (reg & 7));
+}
+
+//
+// Instructions.
+//
+
+void insn_set_target(target_t target)
+{
+	state.target = target;
+}
+
+target_t insn_target()
+{
+	return state.target;
+}
+
+void insn_function(const char* name)
+{
+	if(state.target == TARGET_OBJECT)
+	{
+		object_function(name);
+		return;
+	}
+
+	emit_lit(".globl ");
+	emit_str(name);
+	emit_char('\n');
+	emit_str(name);
+	emit_lit(":\n");
+}
+
+void insn_label(int label)
+{
+	if(state.target == TARGET_OBJECT)
+	{
+		object_label(label);
+		return;
+	}
+
+	emit_label(label);
+	emit_lit(":\n");
+}
+
+void insn_push(reg_t reg, const char* comment)
+{
+	count_insn("push");
+	if(state.target == TARGET_OBJECT)
+	{
+		code_short_reg(0x50, reg);
+		return;
+	}
+
+	text_mnemonic("push");
+	emit_reg(reg, WIDTH_64);
+	if(comment)
+	{
+		emit_lit(" # ");
+		emit_str(comment);
+	}
+	emit_char('\n');
+}
+
+void insn_pop(reg_t reg)
+{
+	count_insn("pop");
+	if(state.target == TARGET_OBJECT)
+	{
+		code_short_reg(0x58, reg);
+		return;
+	}
+
+	text_mnemonic("pop");
+	emit_reg(reg, WIDTH_64);
+	emit_char('\n');
+}
+
+void insn_mov(width_t width, reg_t src, reg_t dst)
+{
+	const char* mnemonic = width == WIDTH_64 ? "mov" : "movl";
+	count_insn(mnemonic);
+	if(state.target == TARGET_OBJECT)
+	{
+		code_rr("\x89", 1, width, src, dst);
+		return;
+	}
+
+	text_mnemonic(mnemonic);
+	emit_reg(src, width);
+	emit_lit(", ");
+	emit_reg(dst, width);
+	emit_char('\n');
+}
+
+void insn_xchg(reg_t reg)
+{
+	count_insn("xchg");
+	if(state.target == TARGET_OBJECT)
+	{
+		code_short_reg(0x90, reg);
+		return;
+	}
+
+	text_mnemonic("xchg");
+	emit_reg(reg, WIDTH_32);
+	emit_lit(", %eax\n");
+}
+
+void insn_mov_imm(int32_t value, reg_t reg)
+{
+	count_insn("movl");
+	if(state.target == TARGET_OBJECT)
+	{
+		code_short_reg(0xb8, reg);
+		object_imm32(value);
+		return;
+	}
+
+	emit_lit("\tmovl $");
+	emit_int(value);
+	emit_lit(", ");
+	emit_reg(reg, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_load(int32_t offset, reg_t reg)
+{
+	count_insn("movl");
+	if(state.target == TARGET_OBJECT)
+	{
+		code_frame_slot(0x8b, reg, offset);
+		return;
+	}
+
+	text_mnemonic("movl");
+	text_frame_slot(offset);
+	emit_lit(", ");
+	emit_reg(reg, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_store(reg_t reg, int32_t offset)
+{
+	count_insn("movl");
+	if(state.target == TARGET_OBJECT)
+	{
+		code_frame_slot(0x89, reg, offset);
+		return;
+	}
+
+	text_mnemonic("movl");
+	emit_reg(reg, WIDTH_32);
+	emit_lit(", ");
+	text_frame_slot(offset);
+	emit_char('\n');
+}
+
+void insn_alu(alu_op_t op, reg_t src, reg_t dst)
+{
+	count_insn(alu_names[op]);
+	if(state.target == TARGET_OBJECT)
+	{
+		if(op == ALU_IMUL)
+		{
+			code_rr("\x0f\xaf", 2, WIDTH_32, dst, src);
+		}
+		else
+		{
+			// The 'op r/m32, r32' form of each group 1 operation.
+			char opcode = op << 3 | 0x01;
+			code_rr(&opcode, 1, WIDTH_32, src, dst);
+		}
+		return;
+	}
+
+	text_mnemonic(alu_names[op]);
+	emit_reg(src, WIDTH_32);
+	emit_lit(", ");
+	emit_reg(dst, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_alu_imm(alu_op_t op, int32_t value, reg_t reg)
+{
+	count_insn(alu_names[op]);
+	if(state.target == TARGET_OBJECT)
+	{
+		if(value >= INT8_MIN && value <= INT8_MAX)
+		{
+			code_rr("\x83", 1, WIDTH_32, op, reg);
+			object_byte((int8_t)value);
+		}
+		else if(reg == REG_AX)
+		{
+			// The shorter form which only operates on %eax.
+			object_byte(op << 3 | 0x05);
+			object_imm32(value);
+		}
+		else
+		{
+			code_rr("\x81", 1, WIDTH_32, op, reg);
+			object_imm32(value);
+		}
+		return;
+	}
+
+	text_mnemonic(alu_names[op]);
+	emit_char('$');
+	emit_int(value);
+	emit_lit(", ");
+	emit_reg(reg, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_unary(unary_op_t op, reg_t reg)
+{
+	count_insn(unary_names[op]);
+	if(state.target == TARGET_OBJECT)
+	{
+		code_rr("\xf7", 1, WIDTH_32, op, reg);
+		return;
+	}
+
+	text_mnemonic(unary_names[op]);
+	emit_reg(reg, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_shift_cl(shift_op_t op, reg_t reg)
+{
+	count_insn(shift_names[op]);
+	if(state.target == TARGET_OBJECT)
+	{
+		code_rr("\xd3", 1, WIDTH_32, op, reg);
+		return;
+	}
+
+	text_mnemonic(shift_names[op]);
+	emit_lit("%cl, ");
+	emit_reg(reg, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_shift_imm(shift_op_t op, int count, reg_t reg)
+{
+	count_insn(shift_names[op]);
+	if(state.target == TARGET_OBJECT)
+	{
+		// Shifts by one have a form without the count, which the assembler
+		// prefers.
+		if(count == 1)
+		{
+			code_rr("\xd1", 1, WIDTH_32, op, reg);
+		}
+		else
+		{
+			code_rr("\xc1", 1, WIDTH_32, op, reg);
+			object_byte(count);
+		}
+		return;
+	}
+
+	text_mnemonic(shift_names[op]);
+	emit_char('$');
+	emit_int(count);
+	emit_lit(", ");
+	emit_reg(reg, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_lea(reg_t base, reg_t index, int scale, reg_t dst)
+{
+	count_insn("leal");
+	if(state.target == TARGET_OBJECT)
+	{
+		int scale_bits = scale == 8 ? 3 : scale == 4 ? 2 : scale == 2 ? 1 : 0;
+		int rex = (dst >= REG_R8 ? REX_R : 0) | (index >= REG_R8 ? REX_X : 0) | (base >= REG_R8 ? REX_B : 0);
+		if(rex)
+		{
+			object_byte(REX | rex);
+		}
+		object_byte(0x8d);
+
+		// A base of %rbp or %r13 with no displacement would mean an absolute
+		// address, so they take a zero 8-bit displacement instead.
+		bool disp8 = (base & 7) == REG_BP;
+		object_byte((disp8 ? 0x44 : 0x04) | (dst & 7) << 3);
+		object_byte(scale_bits << 6 | (index & 7) << 3 | (base & 7));
+		if(disp8)
+		{
+			object_byte(0);
+		}
+		return;
+	}
+
+	text_mnemonic("leal");
+	emit_char('(');
+	emit_reg(base, WIDTH_64);
+	emit_lit(", ");
+	emit_reg(index, WIDTH_64);
+	emit_lit(", ");
+	emit_int(scale);
+	emit_lit("), ");
+	emit_reg(dst, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_setcc(cond_t cond, reg_t reg)
+{
+	// Mnemonics are counted by their full name.
+	char mnemonic[8] = "set";
+	strcat(mnemonic, cond_names[cond]);
+
+	count_insn(mnemonic);
+	if(state.target == TARGET_OBJECT)
+	{
+		char opcode[2] = { 0x0f, 0x90 + cond };
+		code_rr(opcode, 2, WIDTH_8, 0, reg);
+		return;
+	}
+
+	text_mnemonic(mnemonic);
+	emit_reg(reg, WIDTH_8);
+	emit_char('\n');
+}
+
+void insn_cdq()
+{
+	count_insn("cdq");
+	if(state.target == TARGET_OBJECT)
+	{
+		object_byte(0x99);
+		return;
+	}
+
+	emit_lit("\tcdq\n");
+}
+
+void insn_idiv(reg_t reg)
+{
+	count_insn("idivl");
+	if(state.target == TARGET_OBJECT)
+	{
+		code_rr("\xf7", 1, WIDTH_32, 7, reg);
+		return;
+	}
+
+	text_mnemonic("idivl");
+	emit_reg(reg, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_imul_wide(reg_t reg)
+{
+	count_insn("imull");
+	if(state.target == TARGET_OBJECT)
+	{
+		code_rr("\xf7", 1, WIDTH_32, 5, reg);
+		return;
+	}
+
+	text_mnemonic("imull");
+	emit_reg(reg, WIDTH_32);
+	emit_char('\n');
+}
+
+void insn_jump(cond_t cond, int label)
+{
+	char mnemonic[8] = "j";
+	strcat(mnemonic, cond_names[cond]);
+
+	count_insn(mnemonic);
+	if(state.target == TARGET_OBJECT)
+	{
+		object_jump(cond == COND_ALWAYS ? -1 : (int)cond, label);
+		return;
+	}
+
+	text_mnemonic(mnemonic);
+	emit_label(label);
+	emit_char('\n');
+}
+
+void insn_ret()
+{
+	count_insn("ret");
+	if(state.target == TARGET_OBJECT)
+	{
+		object_byte(0xc3);
+		return;
+	}
+
+	emit_lit("\tret\n");
+}
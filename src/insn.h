@@ -0,0 +1,134 @@
+#ifndef _INSN_H
+#define _INSN_H
+
+#include <stdint.h>
+
+#include "emitter.h"
+
+// Instructions used by the generator, each of which can either be written out
+// as AT&T assembly through the emitter, or encoded as x86-64 machine code into
+// the object started with 'object_begin()'.
+//
+// Unless stated otherwise, instructions operate on 32-bit registers.
+
+// Where the instructions generated on a thread go.
+typedef enum
+{
+	TARGET_ASSEMBLY,
+	TARGET_OBJECT
+} target_t;
+
+// Two operand arithmetic and logic operations, given their encoding in the
+// group 1 opcodes.
+typedef enum
+{
+	ALU_ADD = 0,
+	ALU_OR  = 1,
+	ALU_AND = 4,
+	ALU_SUB = 5,
+	ALU_XOR = 6,
+	ALU_CMP = 7,
+
+	// Not part of group 1, only valid between registers.
+	ALU_IMUL = 8
+} alu_op_t;
+
+// Single operand operations, given their encoding in the group 3 opcodes.
+typedef enum
+{
+	UNARY_OP_NOT = 2,
+	UNARY_OP_NEG = 3
+} unary_op_t;
+
+// Shifts, given their encoding in the group 2 opcodes.
+typedef enum
+{
+	SHIFT_SAL = 4,
+	SHIFT_SHR = 5,
+	SHIFT_SAR = 7
+} shift_op_t;
+
+// Condition codes, given their encoding in the 'Jcc' and 'SETcc' opcodes.
+typedef enum
+{
+	COND_E  = 0x4,
+	COND_NE = 0x5,
+	COND_L  = 0xc,
+	COND_GE = 0xd,
+	COND_LE = 0xe,
+	COND_G  = 0xf,
+
+	// Unconditional, only valid for jumps.
+	COND_ALWAYS = 0x10
+} cond_t;
+
+// Selects where instructions generated on the calling thread go.
+void insn_set_target(target_t target);
+
+// Returns where instructions generated on the calling thread go.
+target_t insn_target();
+
+// Defines a global function symbol at the current position.
+void insn_function(const char* name);
+
+// Defines the label with the given id at the current position.
+void insn_label(int label);
+
+// 'push reg' and 'pop reg' on 64-bit registers. 'comment' is appended to
+// the assembly, and may be NULL.
+void insn_push(reg_t reg, const char* comment);
+void insn_pop(reg_t reg);
+
+// 'mov src, dst' at the given width, which is either 32 or 64 bits.
+void insn_mov(width_t width, reg_t src, reg_t dst);
+
+// 'xchg reg, %eax', exchanging the register with %eax, which 'reg' must not
+// be.
+void insn_xchg(reg_t reg);
+
+// 'movl $value, reg'.
+void insn_mov_imm(int32_t value, reg_t reg);
+
+// 'movl offset(%rbp), reg' and 'movl reg, offset(%rbp)'.
+void insn_load(int32_t offset, reg_t reg);
+void insn_store(reg_t reg, int32_t offset);
+
+// 'op src, dst', which leaves its result in 'dst'.
+void insn_alu(alu_op_t op, reg_t src, reg_t dst);
+
+// 'op $value, reg', 'op' must not be ALU_IMUL.
+void insn_alu_imm(alu_op_t op, int32_t value, reg_t reg);
+
+// 'op reg'.
+void insn_unary(unary_op_t op, reg_t reg);
+
+// 'op %cl, reg'.
+void insn_shift_cl(shift_op_t op, reg_t reg);
+
+// 'op $count, reg', 'count' must be between 1 and 31.
+void insn_shift_imm(shift_op_t op, int count, reg_t reg);
+
+// 'leal (base,index,scale), dst', where the address registers are 64-bit
+// and 'scale' is 1, 2, 4 or 8. 'index' must not be %rsp.
+void insn_lea(reg_t base, reg_t index, int scale, reg_t dst);
+
+// 'setcc reg' on the low byte of the register.
+void insn_setcc(cond_t cond, reg_t reg);
+
+// 'cdq', sign-extending %eax into %edx.
+void insn_cdq();
+
+// 'idivl reg', dividing %edx:%eax.
+void insn_idiv(reg_t reg);
+
+// 'imull reg', the signed 64-bit product of %eax and the register, whose high
+// half is left in %edx and low half in %eax.
+void insn_imul_wide(reg_t reg);
+
+// 'jcc label', or 'jmp label' for COND_ALWAYS.
+void insn_jump(cond_t cond, int label);
+
+// 'ret'.
+void insn_ret();
+
+#endif
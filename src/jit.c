@@ -0,0 +1,75 @@
+#include <string.h>
+#include <sys/mman.h>
+
+#include "jit.h"
+#include "object.h"
+#include "buf.h"
+
+struct jit_function
+{
+	const char* name;
+	size_t offset;
+};
+
+bool jit_load(jit_image_t* image)
+{
+	memset(image, 0, sizeof(jit_image_t));
+
+	char* code = NULL;
+	object_link(&code);
+	image->size = sb_count(code);
+
+	// mmap() rejects zero length mappings, and there is nothing to run.
+	if(image->size > 0)
+	{
+		// Pages are never writable and executable at the same time.
+		void* memory = mmap(NULL, image->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if(memory == MAP_FAILED)
+		{
+			sb_free(code);
+			return false;
+		}
+
+		memcpy(memory, code, image->size);
+		if(mprotect(memory, image->size, PROT_READ | PROT_EXEC) < 0)
+		{
+			munmap(memory, image->size);
+			sb_free(code);
+			return false;
+		}
+		__builtin___clear_cache(memory, (char*)memory + image->size);
+		image->memory = memory;
+	}
+	sb_free(code);
+
+	struct jit_function function;
+	uint32_t offset;
+	for(int i = 0; (function.name = object_function_info(i, &offset)); i++)
+	{
+		function.offset = offset;
+		sb_push(image->functions, function);
+	}
+	return true;
+}
+
+void* jit_lookup(jit_image_t* image, const char* name)
+{
+	for(int i = 0; i < sb_count(image->functions); i++)
+	{
+		if(!strcmp(image->functions[i].name, name))
+		{
+			return image->memory + image->functions[i].offset;
+		}
+	}
+	return NULL;
+}
+
+void jit_unload(jit_image_t* image)
+{
+	if(image->memory)
+	{
+		munmap(image->memory, image->size);
+	}
+	sb_free(image->functions);
+	memset(image, 0, sizeof(jit_image_t));
+}
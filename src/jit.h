@@ -0,0 +1,31 @@
+#ifndef _JIT_H
+#define _JIT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Machine code loaded into executable memory in this process, so that it can
+// be called directly without an assembler or linker.
+
+typedef struct
+{
+	char* memory;
+	size_t size;
+
+	// Offsets of the functions in the image, copied from the object.
+	struct jit_function* functions;
+} jit_image_t;
+
+// Lays out the object built on the calling thread, see 'object_begin()', and
+// loads it into newly mapped memory which is executable but not writable.
+// Returns false if the memory could not be mapped.
+bool jit_load(jit_image_t* image);
+
+// Returns the address of the named function in the image, or NULL if the
+// image does not contain it.
+void* jit_lookup(jit_image_t* image, const char* name);
+
+// Unmaps the image, every address in it becomes invalid.
+void jit_unload(jit_image_t* image);
+
+#endif
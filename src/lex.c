@@ -1,11 +1,17 @@
 #include "lex.h"
+#include "stats.h"
 
-// Global state for the lexer.
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+// State for the lexer, each thread has its own.
 // The state is reset with each call to 'lex()'.
-static struct
+static _Thread_local struct
 {
-	char* source;
-	int ptr;
+	const char* source;
+	size_t length;
+	size_t ptr;
 
 	int line;
 
@@ -16,28 +22,90 @@ static struct
 // Character utilities.
 //
 
+// Character classes, a character may belong to several.
+enum
+{
+	CC_WHITESPACE   = 1 << 0,
+	CC_NUMERIC      = 1 << 1,
+	CC_IDENT_START  = 1 << 2
+};
+
+#define CC_IDENT (CC_IDENT_START | CC_NUMERIC)
+
+// Maps every byte to its character classes.
+static const uint8_t char_class[256] =
+{
+	[' ' ] = CC_WHITESPACE,
+	['\n'] = CC_WHITESPACE,
+	['\r'] = CC_WHITESPACE,
+	['\t'] = CC_WHITESPACE,
+
+	['0' ... '9'] = CC_NUMERIC,
+
+	['a' ... 'z'] = CC_IDENT_START,
+	['A' ... 'Z'] = CC_IDENT_START,
+	['_'] = CC_IDENT_START
+};
+
 static bool is_whitespace(char c)
 {
-	return c == 0x20 || c == 0x0A || c == 0x0D || c == 0x09;
+	return char_class[(uint8_t)c] & CC_WHITESPACE;
 }
 
 static bool is_numeric(char c)
 {
-	return c >= '0' && c <= '9';
+	return char_class[(uint8_t)c] & CC_NUMERIC;
 }
 
 // Returns true if the given character can be the first character in an identifier
 // name, false otherwise.
 static bool is_ident_start_char(char c)
 {
-	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c == '_');
+	return char_class[(uint8_t)c] & CC_IDENT_START;
 }
 
 // Returns true if the given character can appear in an identifier name,
 // false otherwise.
 static bool is_ident_char(char c)
 {
-	return is_ident_start_char(c) || is_numeric(c);
+	return char_class[(uint8_t)c] & CC_IDENT;
+}
+
+//
+// Keywords.
+//
+
+typedef struct
+{
+	const char* name;
+	int len;
+	token_type_t type;
+} keyword_t;
+
+// Size of the keyword table, must be a power of two.
+#define KEYWORD_TABLE_SIZE 16
+
+// Perfect hash over the set of keywords, computed from the length and the
+// first and last characters. Adding a keyword requires checking that its
+// slot does not collide with an existing one.
+#define KEYWORD_HASH(len, first, last) \
+	(((len) * 7 + (first) + (last)) & (KEYWORD_TABLE_SIZE - 1))
+
+static const keyword_t keywords[KEYWORD_TABLE_SIZE] =
+{
+	[KEYWORD_HASH(6, 'r', 'n')] = { "return", 6, TKN_RETURN }
+};
+
+// Returns the keyword token type for the given identifier, or TKN_IDENT if
+// the identifier is not a reserved keyword.
+static token_type_t match_keyword(const char* ident, int len)
+{
+	const keyword_t* keyword = &keywords[KEYWORD_HASH(len, ident[0], ident[len - 1])];
+	if(keyword->len == len && !memcmp(keyword->name, ident, len))
+	{
+		return keyword->type;
+	}
+	return TKN_IDENT;
 }
 
 //
@@ -48,14 +116,14 @@ static bool is_ident_char(char c)
 // false otherwise.
 static bool has_next()
 {
-	return state.source[state.ptr] != '\0';
+	return state.ptr < state.length;
 }
 
 // Returns the next character in the input stream, does not increment
-// the pointer.
+// the pointer. Returns '\0' once the end of the input has been reached.
 static char peek()
 {
-	return state.source[state.ptr];
+	return has_next() ? state.source[state.ptr] : '\0';
 }
 
 // Returns the next character in the input stream, incremenets the
@@ -68,6 +136,8 @@ static char next()
 // Allocates a new token on the stack with the given type.
 static token_t new_token(token_type_t type)
 {
+	STAT_INC(tokens);
+
 	token_t token;
 	token.type = type;
 	token.val_integer = 0;
@@ -75,80 +145,157 @@ static token_t new_token(token_type_t type)
 	return token;
 }
 
-// Pushes a new token with the given type to the lexers output stream.
-static void emit(token_type_t type)
-{
-	token_t token = new_token(type);
-	sb_push(state.tokens, token);
-}
-
-// Pushes an new integer token to the lexers output stream.
-static void emit_integer(uint64_t value)
+// Allocates a new integer token on the stack.
+static token_t new_integer_token(uint64_t value)
 {
 	token_t token = new_token(TKN_INTEGER);
 	token.val_integer = value;
-	sb_push(state.tokens, token);
+	return token;
 }
 
-// Pushes a new identifier token to the lexers output stream.
-static void emit_identifier(str_t ident)
+// Allocates a new identifier token on the stack.
+static token_t new_identifier_token(str_t ident)
 {
 	token_t token = new_token(TKN_IDENT);
 	token.val_string = ident;
-	sb_push(state.tokens, token);
+	return token;
 }
 
 //
 // Parse utilities.
 //
 
+// Converts eight ASCII digits, most significant first in memory, into their
+// value using three multiply-and-shift steps which each combine adjacent
+// groups of digits.
+static uint64_t decode_eight_digits(uint64_t chunk)
+{
+	chunk = (chunk & 0x0F0F0F0F0F0F0F0F) * 2561 >> 8;
+	chunk = (chunk & 0x00FF00FF00FF00FF) * 6553601 >> 16;
+	chunk = (chunk & 0x0000FFFF0000FFFF) * 42949672960001 >> 32;
+	return chunk;
+}
+
 // Parses an integer literal from the source input.
 // If source[ptr] is not a valid numeric charatcer, then the
 // output of this function is undefined.
 static uint64_t parse_integer()
 {
-	uint64_t val = 0;
-
+	const char* start = state.source + state.ptr;
 	while(has_next() && is_numeric(peek()))
 	{
-		char c = next();
-		val *= 10;
-		val += (uint64_t)(c - '0');
+		next();
+	}
+	const char* end = state.source + state.ptr;
+
+	// Digits are consumed eight at a time. A short final group is padded
+	// with leading '0's so it can be decoded the same way.
+	uint64_t val = 0;
+	for(const char* p = start; p < end; p += 8)
+	{
+		size_t count = end - p < 8 ? end - p : 8;
+
+		uint64_t chunk = 0x3030303030303030;
+		memcpy((char*)&chunk + (8 - count), p, count);
+
+		uint64_t scale = 1;
+		for(size_t i = 0; i < count; i++)
+		{
+			scale *= 10;
+		}
+		val = val * scale + decode_eight_digits(chunk);
 	}
 	return val;
 }
 
-// Parses an identifier name from the source input.
+#ifdef __SSE2__
+// Returns a mask with a bit set for each byte in the block which is an
+// identifier character.
+static unsigned ident_mask(__m128i block)
+{
+	// Unsigned range checks are performed by biasing each range so that it
+	// starts at -128 and then using a signed comparison.
+	__m128i lower = _mm_or_si128(block, _mm_set1_epi8(0x20));
+	__m128i alpha = _mm_cmplt_epi8(_mm_add_epi8(lower, _mm_set1_epi8(0x80 - 'a')), _mm_set1_epi8(-128 + 26));
+	__m128i digit = _mm_cmplt_epi8(_mm_add_epi8(block, _mm_set1_epi8(0x80 - '0')), _mm_set1_epi8(-128 + 10));
+	__m128i under = _mm_cmpeq_epi8(block, _mm_set1_epi8('_'));
+	return _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(alpha, digit), under));
+}
+#endif
+
+// Skips over a run of whitespace, counting the newlines it contains.
+static void skip_whitespace()
+{
+#ifdef __SSE2__
+	// Scan sixteen bytes at a time while a whole block is available.
+	while(state.ptr + 16 <= state.length)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i*)(state.source + state.ptr));
+		__m128i newline = _mm_cmpeq_epi8(block, _mm_set1_epi8('\n'));
+		__m128i space = _mm_or_si128(
+			_mm_or_si128(newline, _mm_cmpeq_epi8(block, _mm_set1_epi8(' '))),
+			_mm_or_si128(_mm_cmpeq_epi8(block, _mm_set1_epi8('\t')), _mm_cmpeq_epi8(block, _mm_set1_epi8('\r'))));
+
+		unsigned space_mask = _mm_movemask_epi8(space);
+		unsigned newline_mask = _mm_movemask_epi8(newline);
+
+		// Count of leading whitespace bytes in the block.
+		int run = __builtin_ctz(~space_mask);
+		state.line += __builtin_popcount(newline_mask & ((1u << run) - 1));
+		state.ptr += run;
+
+		if(run < 16)
+		{
+			return;
+		}
+	}
+#endif
+
+	while(has_next() && is_whitespace(peek()))
+	{
+		if(next() == '\n')
+		{
+			// If we found a newline, increment the line counter.
+			state.line++;
+		}
+	}
+}
+
+// Skips over an identifier name in the source input, returning its length.
 // If source[ptr] is not a valid identifier character, then the
 // output of this function is undefined.
-static str_t parse_identifier()
+static int scan_identifier()
 {
-	char* start = state.source + state.ptr;
+	size_t start = state.ptr;
+
+#ifdef __SSE2__
+	while(state.ptr + 16 <= state.length)
+	{
+		__m128i block = _mm_loadu_si128((const __m128i*)(state.source + state.ptr));
+		int run = __builtin_ctz(~ident_mask(block));
+		state.ptr += run;
+
+		if(run < 16)
+		{
+			return state.ptr - start;
+		}
+	}
+#endif
 
 	while(has_next() && is_ident_char(peek()))
 	{
 		next();
 	}
-
-	char* end = state.source + state.ptr;
-	int len = end - start;
-	return __(start, len);
+	return state.ptr - start;
 }
 
 //
-// Public API.
+// Lexer body.
 //
 
-token_t* lex(char* source)
+token_t lex_next()
 {
-	// Reset state.
-	state.source = source;
-	state.ptr = 0;
-	state.line = 1;
-	sb_free(state.tokens);
-	state.tokens = NULL;
-
-	// Continue to read tokens until we reach the end of the stream.
+	// Skip over input until we can produce a token.
 	while(has_next())
 	{
 		char c = peek();
@@ -156,11 +303,7 @@ token_t* lex(char* source)
 		// Ignore all whitespace.
 		if(is_whitespace(c))
 		{
-			if(next() == '\n')
-			{
-				// If we found a newline, increment the line counter.
-				state.line++;
-			}
+			skip_whitespace();
 			continue;
 		}
 
@@ -168,38 +311,38 @@ token_t* lex(char* source)
 		if(is_numeric(c))
 		{
 			uint64_t value = parse_integer();
-			emit_integer(value);
-			continue;
+			return new_integer_token(value);
 		}
 
 		// We found an identifier, parse it.
 		if(is_ident_start_char(c))
 		{
-			str_t ident = parse_identifier();
+			const char* start = state.source + state.ptr;
+			int len = scan_identifier();
 
-			// Check for reserved keywords.
-			if(ident == _("return")) { emit(TKN_RETURN); continue; }
+			// Check for reserved keywords, these are never interned.
+			token_type_t keyword = match_keyword(start, len);
+			if(keyword != TKN_IDENT) { return new_token(keyword); }
 
-			// If we didn't find a reserved keyword, just emit an identifier.
-			emit_identifier(ident);
-			continue;
+			// If we didn't find a reserved keyword, just produce an identifier.
+			return new_identifier_token(__(start, len));
 		}
 
 		// Handle all "simple" tokens here.
 		switch(c)
 		{
-		case '{': emit(TKN_L_CURLY  ); next(); continue;
-		case '}': emit(TKN_R_CURLY  ); next(); continue;
-		case '(': emit(TKN_L_PAREN  ); next(); continue;
-		case ')': emit(TKN_R_PAREN  ); next(); continue;
-		case ';': emit(TKN_SEMICOLON); next(); continue;
-		case '-': emit(TKN_MINUS    ); next(); continue;
-		case '~': emit(TKN_TILDE    ); next(); continue;
-		case '+': emit(TKN_PLUS     ); next(); continue;
-		case '*': emit(TKN_ASTERIX  ); next(); continue;
-		case '/': emit(TKN_SLASH    ); next(); continue;
-		case '%': emit(TKN_MODULO   ); next(); continue;
-		case '^': emit(TKN_CARET    ); next(); continue;
+		case '{': next(); return new_token(TKN_L_CURLY  );
+		case '}': next(); return new_token(TKN_R_CURLY  );
+		case '(': next(); return new_token(TKN_L_PAREN  );
+		case ')': next(); return new_token(TKN_R_PAREN  );
+		case ';': next(); return new_token(TKN_SEMICOLON);
+		case '-': next(); return new_token(TKN_MINUS    );
+		case '~': next(); return new_token(TKN_TILDE    );
+		case '+': next(); return new_token(TKN_PLUS     );
+		case '*': next(); return new_token(TKN_ASTERIX  );
+		case '/': next(); return new_token(TKN_SLASH    );
+		case '%': next(); return new_token(TKN_MODULO   );
+		case '^': next(); return new_token(TKN_CARET    );
 
 		// TODO: Better handling of double character tokens.
 		case '&': {
@@ -207,43 +350,37 @@ token_t* lex(char* source)
 			if(peek() == '&')
 			{
 				next();
-				emit(TKN_AMP_AMP);
-				continue;
+				return new_token(TKN_AMP_AMP);
 			}
 			else
 			{
-				emit(TKN_AMP);
-				continue;
+				return new_token(TKN_AMP);
 			}
 		} break;
-		
+	
 		case '|': {
 			next();
 			if(peek() == '|')
 			{
 				next();
-				emit(TKN_PIPE_PIPE);
-				continue;
+				return new_token(TKN_PIPE_PIPE);
 			}
 			else
 			{
-				emit(TKN_PIPE);
-				continue;
+				return new_token(TKN_PIPE);
 			}
 		} break;
-		
+	
 		case '=': {
 			next();
 			if(peek() == '=')
 			{
 				next();
-				emit(TKN_EQ_EQ);
-				continue;
+				return new_token(TKN_EQ_EQ);
 			}
 			else
 			{
-				emit(TKN_EQ);
-				continue;
+				return new_token(TKN_EQ);
 			}
 		} break;
 
@@ -252,13 +389,11 @@ token_t* lex(char* source)
 			if(peek() == '=')
 			{
 				next();
-				emit(TKN_NOT_EQ);
-				continue;
+				return new_token(TKN_NOT_EQ);
 			}
 			else
 			{
-				emit(TKN_BANG);
-				continue;
+				return new_token(TKN_BANG);
 			}
 		} break;
 
@@ -267,40 +402,34 @@ token_t* lex(char* source)
 			if(peek() == '=')
 			{
 				next();
-				emit(TKN_LT_EQ);
-				continue;
+				return new_token(TKN_LT_EQ);
 			}
 			else if(peek() == '<')
 			{
 				next();
-				emit(TKN_LT_LT);
-				continue;
+				return new_token(TKN_LT_LT);
 			}
 			else
 			{
-				emit(TKN_LT);
-				continue;
+				return new_token(TKN_LT);
 			}
 		} break;
-		
+	
 		case '>': {
 			next();
 			if(peek() == '=')
 			{
 				next();
-				emit(TKN_GT_EQ);
-				continue;
+				return new_token(TKN_GT_EQ);
 			}
 			else if(peek() == '>')
 			{
 				next();
-				emit(TKN_GT_GT);
-				continue;
+				return new_token(TKN_GT_GT);
 			}
 			else
 			{
-				emit(TKN_GT);
-				continue;
+				return new_token(TKN_GT);
 			}
 		} break;
 		}
@@ -311,9 +440,37 @@ token_t* lex(char* source)
 		error("unexpected character '%c' at line %d\n", c, state.line);
 	}
 
-	// We've reached the end of the stream, so add a terminating token.
-	emit(TKN_EOF);
+	// We've reached the end of the stream, so produce a terminating token.
+	return new_token(TKN_EOF);
+}
 
-	return state.tokens;
+//
+// Public API.
+//
+
+void lex_begin(const char* source, size_t length)
+{
+	// Reset state.
+	state.source = source;
+	state.length = length;
+	state.ptr = 0;
+	state.line = 1;
 }
 
+token_t* lex(const char* source, size_t length)
+{
+	lex_begin(source, length);
+	sb_free(state.tokens);
+	state.tokens = NULL;
+
+	// Continue to read tokens until we reach the end of the stream, the
+	// terminating token is included in the output.
+	token_t token;
+	do
+	{
+		token = lex_next();
+		sb_push(state.tokens, token);
+	} while(token.type != TKN_EOF);
+
+	return state.tokens;
+}
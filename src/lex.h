@@ -2,13 +2,23 @@
 #define _LEX_H
 
 #include <stdbool.h>
+#include <stddef.h>
 
 #include "token.h"
 #include "error.h"
 
-// Returns a list of tokens given some source input.
+// Returns a list of tokens given 'length' bytes of source input.
+// The input does not need to be NUL terminated.
 // If the lexer encounters an error, the program will terminate and an
 // error message will be printed to the user.
-token_t* lex(char* source);
+token_t* lex(const char* source, size_t length);
+
+// Begins lexing 'length' bytes of source input one token at a time.
+// Tokens are then pulled from the input with 'lex_next()'.
+void lex_begin(const char* source, size_t length);
+
+// Returns the next token from the input given to 'lex_begin()'.
+// Once the end of the input has been reached, every call returns TKN_EOF.
+token_t lex_next();
 
 #endif
@@ -1,32 +1,83 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 
 #include "lex.h"
 #include "parser.h"
+#include "fold.h"
 
 #include "ast_printer.h"
 #include "generator.h"
+#include "stats.h"
+#include "foxc.h"
+#include "server.h"
+#include "cache.h"
+#include "object.h"
+#include "jit.h"
+#include "tier.h"
+#include "vm.h"
 
-char* read_file(char* path)
+typedef struct
+{
+	char* contents;
+	size_t length;
+} source_file_t;
+
+// Maps the file at the given path read-only into memory.
+// Returns false if the file could not be opened or mapped.
+bool map_file(char* path, source_file_t* file)
 {
-	FILE* f = fopen(path, "rb");
+	int fd = open(path, O_RDONLY);
 
-	if(f == NULL)
+	if(fd < 0)
 	{
-		return NULL;
+		return false;
 	}
 
-	fseek(f, 0, SEEK_END);
-	long fsize = ftell(f);
-	fseek(f, 0, SEEK_SET);
+	struct stat st;
+	if(fstat(fd, &st) < 0)
+	{
+		close(fd);
+		return false;
+	}
 
-	char* contents = malloc(fsize + 1);
-	fread(contents, 1, fsize, f);
-	fclose(f);
+	file->contents = NULL;
+	file->length = st.st_size;
 
-	contents[fsize] = 0;
+	// mmap() rejects zero length mappings, an empty file simply has no contents.
+	if(file->length > 0)
+	{
+		void* contents = mmap(NULL, file->length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(contents == MAP_FAILED)
+		{
+			close(fd);
+			return false;
+		}
+
+		// The lexer makes a single forward pass over the input.
+		madvise(contents, file->length, MADV_SEQUENTIAL);
+		file->contents = contents;
+	}
 
-	return contents;
+	// The mapping stays valid after the descriptor is closed.
+	close(fd);
+	return true;
+}
+
+void unmap_file(source_file_t* file)
+{
+	if(file->contents)
+	{
+		munmap(file->contents, file->length);
+	}
 }
 
 #define C_RESET     "\033[0m"
@@ -43,96 +94,1080 @@ char* read_file(char* path)
 #define C_BOLD_GREEN "\033[1;32m"
 #define C_BOLD_BLUE  "\033[1;34m"
 
-void print_token(token_t* t)
+// Reads a line from stdin onto the end of the given stretchy buffer, without
+// its newline. Returns false once the end of the input is reached.
+bool read_line(char** text)
 {
-	int line = 0;
-    printf(C_CYAN "%4d" C_RESET " %-12s " C_RED, line, token_type_names[t->type]);
-    switch(t->type)
-    {
-    case TKN_INTEGER: { printf("%ld", t->val_integer); break; }
-    case TKN_IDENT:   { printf("%s",  t->val_string ); break; }
-    default: break;
-    }
-    printf(C_RESET "\n");
+	char* line = NULL;
+	size_t capacity = 0;
+	ssize_t r = getline(&line, &capacity, stdin);
+	if(r < 0)
+	{
+		free(line);
+		return false;
+	}
+
+	if(r > 0 && line[r - 1] == '\n')
+	{
+		r--;
+	}
+	memcpy(sb_add(*text, (int)r), line, r);
+	free(line);
+	return true;
 }
 
-void print_tokens(token_t* tokens)
+// State kept between the inputs of a REPL session.
+typedef struct
+{
+	// Variables declared at the top level, and the frame holding their
+	// values. The variables take up the end of the frame, which is moved to
+	// the end of a larger one as it grows.
+	generate_session_t session;
+	char* frame;
+	size_t frame_capacity;
+
+	// Code of the functions defined so far. A function defined again
+	// replaces the earlier definition.
+	jit_image_t* images;
+} repl_t;
+
+// Returns the address of the most recent definition of the named function,
+// or NULL if it has not been defined.
+void* repl_lookup(repl_t* repl, const char* name)
 {
-    printf(C_BOLD_GREEN "line type         value" C_RESET "\n");
-    for(int i = 0; i < sb_count(tokens); i++)
-    {
-        print_token(&tokens[i]);
-    }
+	for(int i = sb_count(repl->images) - 1; i >= 0; i--)
+	{
+		void* function = jit_lookup(&repl->images[i], name);
+		if(function)
+		{
+			return function;
+		}
+	}
+	return NULL;
 }
 
-typedef struct
+// Grows the frame to hold every variable of the session.
+void repl_reserve_frame(repl_t* repl)
 {
-    char* buffer;
-    size_t buffer_length;
-    int input_length;
-} input_buf_t;
+	size_t needed = repl->session.frame_size;
+	if(needed <= repl->frame_capacity)
+	{
+		return;
+	}
 
-input_buf_t read_input()
+	size_t capacity = repl->frame_capacity ? repl->frame_capacity : 256;
+	while(capacity < needed)
+	{
+		capacity *= 2;
+	}
+
+	char* frame = calloc(1, capacity);
+	if(repl->frame)
+	{
+		memcpy(frame + capacity - repl->frame_capacity, repl->frame, repl->frame_capacity);
+		free(repl->frame);
+	}
+	repl->frame = frame;
+	repl->frame_capacity = capacity;
+}
+
+// Loads the object built on the calling thread into memory, and keeps it for
+// the rest of the session. Returns NULL if it could not be loaded.
+jit_image_t* repl_load(repl_t* repl)
 {
-    input_buf_t buf;
-    buf.buffer = 0;
+	jit_image_t image;
+	if(!jit_load(&image))
+	{
+		printf("unable to map executable memory\n");
+		return NULL;
+	}
+	sb_push(repl->images, image);
+	return &sb_last(repl->images);
+}
 
-    int r = getline(&(buf.buffer), &(buf.buffer_length), stdin);
+// Returns true if the tokens are a function definition.
+bool is_definition(token_t* tokens)
+{
+	return sb_count(tokens) > 3
+		&& tokens[0].type == TKN_IDENT && tokens[0].val_string == _("int")
+		&& tokens[1].type == TKN_IDENT
+		&& tokens[2].type == TKN_L_PAREN;
+}
 
-    buf.input_length = r - 1;
-    buf.buffer[r - 1] = 0;
+// Returns true if the tokens are a call to a function, 'name()', which is
+// only understood by the REPL.
+bool is_call(token_t* tokens)
+{
+	int n = sb_count(tokens);
+	return (n == 4 || (n == 5 && tokens[3].type == TKN_SEMICOLON))
+		&& tokens[0].type == TKN_IDENT
+		&& tokens[1].type == TKN_L_PAREN
+		&& tokens[2].type == TKN_R_PAREN;
+}
 
-    return buf;
+// Compiles and runs a single input of the session. Definitions are compiled
+// and kept, calls run a function defined earlier, and anything else is run
+// as statements. The value of a trailing expression or return is printed.
+// If the input has an error, the program will terminate and an error message
+// will be printed to the user.
+void repl_eval(repl_t* repl, token_t* tokens)
+{
+	if(is_definition(tokens))
+	{
+		program_t* program = parse(tokens);
+		fold_program(program);
+		object_begin();
+		generate(program);
+		free_program(program);
+		repl_load(repl);
+		return;
+	}
+
+	if(is_call(tokens))
+	{
+		int (*function)() = repl_lookup(repl, tokens[0].val_string);
+		if(function == NULL)
+		{
+			error("'%s' is not defined\n", tokens[0].val_string);
+		}
+		printf("%d\n", function());
+		return;
+	}
+
+	decl_t* decl = _parse_statements(tokens);
+	decl->name = _("repl");
+	fold_declaration(decl);
+
+	object_begin();
+	generate_session_function(&repl->session, decl);
+	jit_image_t* image = repl_load(repl);
+	if(image == NULL)
+	{
+		return;
+	}
+
+	repl_reserve_frame(repl);
+	int (*line)(char*) = jit_lookup(image, decl->name);
+	int value = line(repl->frame + repl->frame_capacity);
+
+	// Statements are only run once, so their code is not kept.
+	jit_unload(image);
+	stb__sbn(repl->images)--;
+
+	if(decl->stmt_count > 0)
+	{
+		stmt_type_t type = decl->stmts[decl->stmt_count - 1]->type;
+		if(type == STMT_EXPR || type == STMT_RETURN)
+		{
+			printf("%d\n", value);
+		}
+	}
+}
+
+// Returns the nesting depth of braces at the end of the tokens.
+int brace_depth(token_t* tokens)
+{
+	int depth = 0;
+	for(int i = 0; i < sb_count(tokens); i++)
+	{
+		if(tokens[i].type == TKN_L_CURLY) depth++;
+		if(tokens[i].type == TKN_R_CURLY) depth--;
+	}
+	return depth;
 }
 
+// Reads inputs from stdin, compiling each one to native code and running it
+// straight away. Variables and functions are kept for the rest of the
+// session, and an error only discards the input it was found in.
+// An input continues over several lines while it has unclosed braces, and
+// a missing semicolon at the end of a statement is added.
 void run_repl()
 {
-    for(;;)
-    {
-        printf("> ");
-        input_buf_t b = read_input();
+	repl_t repl;
+	memset(&repl, 0, sizeof(repl));
+	insn_set_target(TARGET_OBJECT);
+
+	char* text = NULL;
+	for(;;)
+	{
+		printf(text ? "... " : "> ");
+		fflush(stdout);
+
+		if(!read_line(&text))
+		{
+			break;
+		}
+		sb_push(text, '\n');
+
+		error_recovery_t recovery;
+		if(setjmp(recovery.env) == 0)
+		{
+			error_set_recovery(&recovery);
+
+			token_t* tokens = lex(text, sb_count(text));
+			if(brace_depth(tokens) > 0)
+			{
+				// Keep reading until the braces are closed.
+				error_set_recovery(NULL);
+				continue;
+			}
+
+			int n = sb_count(tokens);
+			if(n > 1 && tokens[n - 2].type != TKN_SEMICOLON && tokens[n - 2].type != TKN_R_CURLY)
+			{
+				sb_push(text, ';');
+				tokens = lex(text, sb_count(text));
+			}
+
+			if(sb_count(tokens) > 1)
+			{
+				repl_eval(&repl, tokens);
+			}
+		}
+		else
+		{
+			printf(C_BOLD_RED "error: " C_RESET "%s", recovery.message);
+		}
+		error_set_recovery(NULL);
+
+		sb_free(text);
+		text = NULL;
+	}
+	sb_free(text);
+	printf("\n");
+
+	for(int i = 0; i < sb_count(repl.images); i++)
+	{
+		jit_unload(&repl.images[i]);
+	}
+	sb_free(repl.images);
+	generate_session_free(&repl.session);
+	free(repl.frame);
+}
+
+// Command line options.
+typedef struct
+{
+	// Compile one declaration at a time, see 'compile_streaming()'.
+	bool stream;
+	// Print the AST through its flat representation.
+	bool flat_ast;
+
+	// Print phase timings, and optionally all counters, to stderr.
+	bool time_report;
+	bool stats;
+	// Path to write a Chrome trace of the compilation to, or NULL.
+	char* trace_path;
+
+	// Number of files to compile at once, or of connections a server serves
+	// at once. Zero if not given.
+	int jobs;
+
+	// Serve compile requests, or forward the files to compile to a server,
+	// on the Unix domain socket at 'socket_path'.
+	bool server;
+	bool client;
+	const char* socket_path;
+
+	// Write an ELF object rather than assembly.
+	bool object;
+
+	// Generate optimized code.
+	bool optimize;
+
+	// Run the program in memory rather than writing any output, calling its
+	// 'main' function 'calls' times.
+	bool run;
+	int calls;
+	// Run functions unoptimized at first, and optimize each one once it has
+	// been called 'tier_threshold' times, see 'tier_create()'.
+	bool tiered;
+	uint32_t tier_threshold;
+	// Run the program with the bytecode interpreter rather than as machine
+	// code, see 'vm.h'.
+	bool vm;
+
+	// Directory of the code cache, or NULL to generate every function.
+	char* cache_dir;
+	code_cache_t* cache;
+
+	// Paths of the files to compile.
+	char** paths;
+} options_t;
+
+// Compiles the whole input at once, the full token list and AST are held in
+// memory until generation is complete. The AST is printed if 'print' is set.
+// Output goes wherever the generator's target sends it, which the caller
+// must have set up.
+void compile(source_file_t* source, options_t* options, bool print)
+{
+	stats_begin(PHASE_LEX);
+	token_t* tokens = lex(source->contents, source->length);
+	stats_end(PHASE_LEX);
+
+	stats_begin(PHASE_PARSE);
+	program_t* program = parse(tokens);
+	stats_end(PHASE_PARSE);
+
+	if(print)
+	{
+		stats_begin(PHASE_PRINT_AST);
+		if(options->flat_ast)
+		{
+			// Print through the flat representation rather than the tree.
+			flat_ast_t ast;
+			flatten_program(&ast, program);
+			print_flat_ast(stdout, &ast);
+			free_flat_ast(&ast);
+		}
+		else
+		{
+			print_ast(stdout, program);
+		}
+		stats_end(PHASE_PRINT_AST);
+	}
+
+	stats_begin(PHASE_OPTIMIZE);
+	fold_program(program);
+	stats_end(PHASE_OPTIMIZE);
+
+	stats_begin(PHASE_GENERATE);
+	generate(program);
+	stats_end(PHASE_GENERATE);
+
+	free_program(program);
+}
+
+// Compiles the input one top-level declaration at a time. Tokens are pulled
+// from the lexer as the parser needs them, and each declaration is generated
+// and released as soon as it has been parsed, so peak memory depends on the
+// largest function rather than the size of the input.
+// Lexing is interleaved with parsing, so it is timed as part of the parse.
+void compile_streaming(source_file_t* source, bool print)
+{
+	lex_begin(source->contents, source->length);
+	parse_begin();
+	generate_begin();
+
+	for(;;)
+	{
+		stats_begin(PHASE_PARSE);
+		decl_t* decl = parse_next_decl();
+		stats_end(PHASE_PARSE);
+
+		if(decl == NULL)
+		{
+			break;
+		}
+
+		if(print)
+		{
+			stats_begin(PHASE_PRINT_AST);
+			print_declaration(stdout, decl);
+			stats_end(PHASE_PRINT_AST);
+		}
+
+		stats_begin(PHASE_OPTIMIZE);
+		fold_declaration(decl);
+		stats_end(PHASE_OPTIMIZE);
+
+		stats_begin(PHASE_GENERATE);
+		generate_declaration(decl);
+		stats_end(PHASE_GENERATE);
+	}
+
+	stats_begin(PHASE_GENERATE);
+	generate_end();
+	stats_end(PHASE_GENERATE);
+}
+
+// Lays out the object built by 'compile()' or 'compile_streaming()' when the
+// target is TARGET_OBJECT, and writes it to the given file.
+void write_object(int fd)
+{
+	stats_begin(PHASE_GENERATE);
+	char* elf = NULL;
+	object_write_elf(&elf);
+
+	emit_begin(fd);
+	emit_bytes(elf, sb_count(elf));
+	emit_end();
 
-        token_t* tokens = lex(b.buffer);
-        print_tokens(tokens);
-        free(b.buffer);
+	sb_free(elf);
+	stats_end(PHASE_GENERATE);
+}
+
+// Runs the program through the tiered engine, which needs the whole AST for
+// as long as the program runs, so it is never streamed.
+bool run_tiered(source_file_t* source, options_t* options, int* status)
+{
+	stats_begin(PHASE_LEX);
+	token_t* tokens = lex(source->contents, source->length);
+	stats_end(PHASE_LEX);
 
-		stmt_t* statement = _parse_statement(tokens);
+	stats_begin(PHASE_PARSE);
+	program_t* program = parse(tokens);
+	stats_end(PHASE_PARSE);
 
-		print_statement(stdout, statement);
-    }
+	stats_begin(PHASE_OPTIMIZE);
+	fold_program(program);
+	stats_end(PHASE_OPTIMIZE);
+
+	stats_begin(PHASE_GENERATE);
+	tier_engine_t* engine = tier_create(program, options->tier_threshold);
+	stats_end(PHASE_GENERATE);
+
+	if(engine == NULL)
+	{
+		printf("unable to map executable memory\n");
+		free_program(program);
+		return false;
+	}
+
+	int (*entry)() = tier_lookup(engine, "main");
+	if(entry == NULL)
+	{
+		printf("no 'main' function to run\n");
+		tier_destroy(engine);
+		free_program(program);
+		return false;
+	}
+
+	stats_begin(PHASE_RUN);
+	for(int i = 0; i < options->calls; i++)
+	{
+		*status = entry();
+	}
+	stats_end(PHASE_RUN);
+
+	tier_destroy(engine);
+	free_program(program);
+	return true;
+}
+
+// Runs the program with the bytecode interpreter. As bytecode does not refer
+// to the AST, a streamed declaration is compiled and released straight away.
+bool run_bytecode(source_file_t* source, options_t* options, int* status)
+{
+	vm_program_t* program = vm_create();
+
+	if(options->stream)
+	{
+		lex_begin(source->contents, source->length);
+		parse_begin();
+		for(;;)
+		{
+			stats_begin(PHASE_PARSE);
+			decl_t* decl = parse_next_decl();
+			stats_end(PHASE_PARSE);
+
+			if(decl == NULL)
+			{
+				break;
+			}
+
+			stats_begin(PHASE_OPTIMIZE);
+			fold_declaration(decl);
+			stats_end(PHASE_OPTIMIZE);
+
+			stats_begin(PHASE_GENERATE);
+			vm_compile(program, decl);
+			stats_end(PHASE_GENERATE);
+		}
+	}
+	else
+	{
+		stats_begin(PHASE_LEX);
+		token_t* tokens = lex(source->contents, source->length);
+		stats_end(PHASE_LEX);
+
+		stats_begin(PHASE_PARSE);
+		program_t* ast = parse(tokens);
+		stats_end(PHASE_PARSE);
+
+		stats_begin(PHASE_OPTIMIZE);
+		fold_program(ast);
+		stats_end(PHASE_OPTIMIZE);
+
+		stats_begin(PHASE_GENERATE);
+		for(int i = 0; i < ast->decl_count; i++)
+		{
+			vm_compile(program, ast->decls[i]);
+		}
+		stats_end(PHASE_GENERATE);
+		free_program(ast);
+	}
+
+	int entry = vm_lookup(program, "main");
+	if(entry < 0)
+	{
+		printf("no 'main' function to run\n");
+		vm_destroy(program);
+		return false;
+	}
+
+	stats_begin(PHASE_RUN);
+	for(int i = 0; i < options->calls; i++)
+	{
+		*status = vm_run(program, entry);
+	}
+	stats_end(PHASE_RUN);
+
+	vm_destroy(program);
+	return true;
+}
+
+// Compiles the input straight into executable memory and calls its 'main'
+// function in this process, returning the result of its last call in
+// 'status'. Returns false if the program could not be run.
+bool run_program(source_file_t* source, options_t* options, int* status)
+{
+	if(options->tiered)
+	{
+		return run_tiered(source, options, status);
+	}
+	if(options->vm)
+	{
+		return run_bytecode(source, options, status);
+	}
+
+	object_begin();
+	insn_set_target(TARGET_OBJECT);
+
+	if(options->stream)
+	{
+		compile_streaming(source, false);
+	}
+	else
+	{
+		compile(source, options, false);
+	}
+
+	stats_begin(PHASE_GENERATE);
+	jit_image_t image;
+	bool loaded = jit_load(&image);
+	stats_end(PHASE_GENERATE);
+
+	if(!loaded)
+	{
+		printf("unable to map executable memory\n");
+		return false;
+	}
+
+	int (*entry)() = jit_lookup(&image, "main");
+	if(entry == NULL)
+	{
+		printf("no 'main' function to run\n");
+		jit_unload(&image);
+		return false;
+	}
+
+	stats_begin(PHASE_RUN);
+	for(int i = 0; i < options->calls; i++)
+	{
+		*status = entry();
+	}
+	stats_end(PHASE_RUN);
+	jit_unload(&image);
+	return true;
+}
+
+// Returns the path a file compiled as part of a batch is written to, which
+// is the input path with its '.c' extension replaced by the given one.
+// The returned string must be freed by the caller.
+char* output_path(const char* path, const char* extension)
+{
+	size_t length = strlen(path);
+	if(length > 2 && !strcmp(path + length - 2, ".c"))
+	{
+		length -= 2;
+	}
+
+	char* out = malloc(length + strlen(extension) + 1);
+	memcpy(out, path, length);
+	strcpy(out + length, extension);
+	return out;
+}
+
+// Writes 'length' bytes to the file at the given path, replacing it.
+// Returns false if the file could not be written.
+bool write_file(const char* path, const char* bytes, size_t length)
+{
+	int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+	{
+		return false;
+	}
+
+	size_t written = 0;
+	while(written < length)
+	{
+		ssize_t r = write(fd, bytes + written, length - written);
+		if(r < 0)
+		{
+			close(fd);
+			return false;
+		}
+		written += r;
+	}
+
+	return close(fd) == 0;
+}
+
+// Compiles one file of a batch into its own output using the given context,
+// reporting any error against its path. Returns false if the file failed to
+// compile.
+bool compile_unit(foxc_context_t* context, char* path, options_t* options)
+{
+	source_file_t source;
+	if(!map_file(path, &source))
+	{
+		fprintf(stderr, "%s: unable to open file\n", path);
+		return false;
+	}
+
+	foxc_options_t unit_options = { 0 };
+	unit_options.stream = options->stream;
+	unit_options.cache = options->cache;
+	unit_options.object = options->object;
+	unit_options.optimize = options->optimize;
+
+	foxc_result_t result = foxc_compile(context, source.contents, source.length, &unit_options);
+	unmap_file(&source);
+
+	if(!result.ok)
+	{
+		fprintf(stderr, "%s: %s\n", path, result.diagnostic);
+		return false;
+	}
+
+	char* out = output_path(path, options->object ? ".o" : ".s");
+	bool ok = write_file(out, result.assembly, result.assembly_length);
+	if(!ok)
+	{
+		fprintf(stderr, "%s: unable to write file '%s'\n", path, out);
+	}
+	free(out);
+	return ok;
+}
+
+// Work shared by every thread compiling a batch.
+typedef struct
+{
+	options_t* options;
+
+	// Index of the next file to be compiled.
+	atomic_int next;
+	atomic_int failures;
+} batch_t;
+
+// Compiles files from the batch until there are none left.
+void* batch_worker(void* arg)
+{
+	batch_t* batch = arg;
+	options_t* options = batch->options;
+
+	if(options->time_report || options->stats || options->trace_path)
+	{
+		stats_enable();
+	}
+
+	// A context is reused for every file this thread compiles.
+	foxc_context_t* context = foxc_create();
+
+	for(;;)
+	{
+		int i = atomic_fetch_add(&batch->next, 1);
+		if(i >= sb_count(options->paths))
+		{
+			break;
+		}
+
+		if(!compile_unit(context, options->paths[i], options))
+		{
+			atomic_fetch_add(&batch->failures, 1);
+		}
+	}
+
+	foxc_destroy(context);
+	stats_flush();
+	return NULL;
+}
+
+// Compiles every file given on the command line, using up to 'jobs' threads.
+// Each thread has its own compiler state, and takes the next file from the
+// batch whenever it finishes one. Returns the number of files which failed.
+int compile_batch(options_t* options)
+{
+	batch_t batch;
+	batch.options = options;
+	atomic_init(&batch.next, 0);
+	atomic_init(&batch.failures, 0);
+
+	int jobs = options->jobs > 0 ? options->jobs : 1;
+	if(jobs > sb_count(options->paths))
+	{
+		jobs = sb_count(options->paths);
+	}
+
+	// The calling thread is one of the workers.
+	pthread_t* threads = malloc(jobs * sizeof(pthread_t));
+	int started = 0;
+	for(int i = 1; i < jobs; i++)
+	{
+		if(pthread_create(&threads[started], NULL, batch_worker, &batch) != 0)
+		{
+			break;
+		}
+		started++;
+	}
+
+	batch_worker(&batch);
+
+	for(int i = 0; i < started; i++)
+	{
+		pthread_join(threads[i], NULL);
+	}
+	free(threads);
+
+	return atomic_load(&batch.failures);
+}
+
+// Compiles every file given on the command line through the compile server.
+// A single file is written to 'out.s', or 'out.o' with -c, and a batch of
+// files each to their own output, as when compiling locally. The AST is not
+// printed.
+// Returns the number of files which failed, or -1 if the server could not be
+// reached.
+int compile_remote(options_t* options)
+{
+	server_client_t client;
+	if(!server_connect(&client, options->socket_path))
+	{
+		fprintf(stderr, "unable to connect to server '%s': %s\n", options->socket_path, strerror(errno));
+		return -1;
+	}
+
+	uint32_t flags = 0;
+	flags |= options->stream ? SERVER_FLAG_STREAM : 0;
+	flags |= options->object ? SERVER_FLAG_OBJECT : 0;
+	flags |= options->optimize ? SERVER_FLAG_OPTIMIZE : 0;
+	int failures = 0;
+
+	for(int i = 0; i < sb_count(options->paths); i++)
+	{
+		char* path = options->paths[i];
+
+		source_file_t source;
+		if(!map_file(path, &source))
+		{
+			fprintf(stderr, "%s: unable to open file\n", path);
+			failures++;
+			continue;
+		}
+
+		bool ok;
+		bool sent = server_compile(&client, source.contents, source.length, flags, &ok);
+		unmap_file(&source);
+
+		if(!sent)
+		{
+			fprintf(stderr, "lost connection to server '%s'\n", options->socket_path);
+			server_disconnect(&client);
+			return -1;
+		}
+
+		if(!ok)
+		{
+			fprintf(stderr, "%s: %s\n", path, client.body);
+			failures++;
+			continue;
+		}
+
+		const char* extension = options->object ? ".o" : ".s";
+		char* out = sb_count(options->paths) > 1 ? output_path(path, extension) : strdup(options->object ? "out.o" : "out.s");
+		if(!write_file(out, client.body, sb_count(client.body)))
+		{
+			fprintf(stderr, "%s: unable to write file '%s'\n", path, out);
+			failures++;
+		}
+		free(out);
+	}
+
+	server_disconnect(&client);
+	return failures;
+}
+
+void print_usage(char* name)
+{
+	printf("usage: %s [--stream] [--flat-ast] [-ftime-report] [--stats] [--trace file] [-j jobs] [--cache dir] [-c] [-O] [file...]\n", name);
+	printf("       %s --run [--stream] [-O] [--calls n] file\n", name);
+	printf("       %s --run --tiered [--tier-threshold n] [--calls n] file\n", name);
+	printf("       %s --run --vm [--stream] [--calls n] file\n", name);
+	printf("       %s --server [--socket path] [-j workers]\n", name);
+	printf("       %s --client [--socket path] [--stream] [-c] [-O] file...\n", name);
+}
+// Parses the command line into the given options.
+// Returns false if the command line is malformed.
+bool parse_options(int argc, char** argv, options_t* options)
+{
+	memset(options, 0, sizeof(options_t));
+	options->calls = 1;
+	options->tier_threshold = TIER_DEFAULT_THRESHOLD;
+
+	for(int i = 1; i < argc; i++)
+	{
+		if(!strcmp(argv[i], "--stream"))
+		{
+			options->stream = true;
+		}
+		else if(!strcmp(argv[i], "--flat-ast"))
+		{
+			options->flat_ast = true;
+		}
+		else if(!strcmp(argv[i], "-ftime-report"))
+		{
+			options->time_report = true;
+		}
+		else if(!strcmp(argv[i], "--stats"))
+		{
+			options->stats = true;
+		}
+		else if(!strcmp(argv[i], "--trace") && i + 1 < argc)
+		{
+			options->trace_path = argv[++i];
+		}
+		else if(!strcmp(argv[i], "-j") && i + 1 < argc)
+		{
+			options->jobs = atoi(argv[++i]);
+			if(options->jobs < 1)
+			{
+				return false;
+			}
+		}
+		else if(!strcmp(argv[i], "-c"))
+		{
+			options->object = true;
+		}
+		else if(!strcmp(argv[i], "-O"))
+		{
+			options->optimize = true;
+		}
+		else if(!strcmp(argv[i], "--run"))
+		{
+			options->run = true;
+		}
+		else if(!strcmp(argv[i], "--calls") && i + 1 < argc)
+		{
+			options->calls = atoi(argv[++i]);
+			if(options->calls < 1)
+			{
+				return false;
+			}
+		}
+		else if(!strcmp(argv[i], "--vm"))
+		{
+			options->vm = true;
+		}
+		else if(!strcmp(argv[i], "--tiered"))
+		{
+			options->tiered = true;
+		}
+		else if(!strcmp(argv[i], "--tier-threshold") && i + 1 < argc)
+		{
+			int threshold = atoi(argv[++i]);
+			if(threshold < 1)
+			{
+				return false;
+			}
+			options->tier_threshold = threshold;
+		}
+		else if(!strcmp(argv[i], "--server"))
+		{
+			options->server = true;
+		}
+		else if(!strcmp(argv[i], "--client"))
+		{
+			options->client = true;
+		}
+		else if(!strcmp(argv[i], "--socket") && i + 1 < argc)
+		{
+			options->socket_path = argv[++i];
+		}
+		else if(!strcmp(argv[i], "--cache") && i + 1 < argc)
+		{
+			options->cache_dir = argv[++i];
+		}
+		else if(argv[i][0] != '-')
+		{
+			sb_push(options->paths, argv[i]);
+		}
+		else
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+// Reports the collected statistics as requested by the given options.
+void report_stats(options_t* options)
+{
+	stats_flush();
+
+	if(options->time_report || options->stats)
+	{
+		stats_print(stderr, options->stats);
+	}
+
+	if(options->trace_path)
+	{
+		FILE* f = fopen(options->trace_path, "w");
+		if(f == NULL)
+		{
+			printf("unable to open file '%s'\n", options->trace_path);
+			return;
+		}
+		stats_write_trace(f);
+		fclose(f);
+	}
 }
 
 int main(int argc, char** argv)
 {
-	if(argc == 1)
+	options_t options;
+
+	if(!parse_options(argc, argv, &options)
+		|| (options.client && (sb_count(options.paths) == 0 || options.cache_dir || options.flat_ast || options.run))
+		|| (options.run && sb_count(options.paths) != 1)
+		|| (options.tiered && (!options.run || options.stream || options.optimize || options.vm))
+		|| (options.vm && !options.run))
 	{
-		run_repl();
+		print_usage(argv[0]);
+		return 1;
 	}
-	if(argc == 2)
+
+	if(options.time_report || options.stats || options.trace_path)
 	{
-		char* source = read_file(argv[1]);
+		stats_enable();
+	}
+	generate_set_optimize(options.optimize);
 
-		if(source == NULL)
+	if((options.server || options.client) && options.socket_path == NULL)
+	{
+		options.socket_path = server_default_socket();
+		if(options.socket_path == NULL)
 		{
-			printf("unable to open file '%s'\n", argv[1]);
+			fprintf(stderr, "unable to use a private directory for the server socket: %s\n", strerror(errno));
 			return 1;
 		}
+	}
 
-		token_t* tokens = lex(source);
-		program_t* program = parse(tokens);
+	if(options.server)
+	{
+		int workers = options.jobs > 0 ? options.jobs : SERVER_DEFAULT_WORKERS;
+		if(!run_server(options.socket_path, workers))
+		{
+			fprintf(stderr, "unable to listen on '%s': %s\n", options.socket_path, strerror(errno));
+		}
+		return 1;
+	}
 
-		print_ast(stdout, program);
+	if(options.client)
+	{
+		int failures = compile_remote(&options);
+		sb_free(options.paths);
+		return failures ? 1 : 0;
+	}
 
-		FILE* f = fopen("out.s", "wb");
-		generate(f, program);
-		fclose(f);
+	if(sb_count(options.paths) == 0)
+	{
+		run_repl();
+		return 0;
+	}
+
+	if(options.cache_dir)
+	{
+		options.cache = cache_open(options.cache_dir);
+		if(options.cache == NULL)
+		{
+			fprintf(stderr, "unable to open cache '%s'\n", options.cache_dir);
+		}
+	}
 
-		free(source);
+	// Several files are each compiled into their own output.
+	if(sb_count(options.paths) > 1)
+	{
+		int failures = compile_batch(&options);
+		cache_close(options.cache);
+		report_stats(&options);
+		sb_free(options.paths);
+		return failures ? 1 : 0;
+	}
+
+	source_file_t source;
+
+	if(!map_file(options.paths[0], &source))
+	{
+		printf("unable to open file '%s'\n", options.paths[0]);
+		return 1;
+	}
+
+	if(options.run)
+	{
+		int status = 0;
+		bool ran = run_program(&source, &options, &status);
+		unmap_file(&source);
+		report_stats(&options);
+		sb_free(options.paths);
+		return ran ? status : 1;
+	}
+
+	const char* out_path = options.object ? "out.o" : "out.s";
+	int fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if(fd < 0)
+	{
+		printf("unable to open file '%s'\n", out_path);
+		return 1;
+	}
+
+	if(options.object)
+	{
+		object_begin();
+		insn_set_target(TARGET_OBJECT);
+	}
+	else
+	{
+		emit_begin(fd);
+		generate_set_cache(options.cache);
+	}
+
+	if(options.stream)
+	{
+		compile_streaming(&source, true);
+	}
+	else
+	{
+		compile(&source, &options, true);
+	}
+
+	if(options.object)
+	{
+		write_object(fd);
 	}
 	else
 	{
-		printf("usage: %s [file]\n", argv[0]);
+		stats_begin(PHASE_GENERATE);
+		emit_end();
+		stats_end(PHASE_GENERATE);
 	}
 
+	close(fd);
+	unmap_file(&source);
+	cache_close(options.cache);
+
+	report_stats(&options);
+	sb_free(options.paths);
+
 	return 0;
 }
@@ -0,0 +1,508 @@
+#include <stdbool.h>
+#include <string.h>
+#include <elf.h>
+
+#include "object.h"
+#include "error.h"
+#include "buf.h"
+#include "stats.h"
+
+// A position in the code. Jumps are not part of the code buffer, so a
+// position is an offset into the buffer together with the number of jumps
+// recorded before it.
+typedef struct
+{
+	uint32_t offset;
+	uint32_t jumps;
+} position_t;
+
+typedef struct
+{
+	position_t at;
+	int cond;
+	int label;
+
+	// Encoded size, either short (rel8) or near (rel32).
+	uint32_t size;
+} jump_t;
+
+typedef struct
+{
+	const char* name;
+	position_t at;
+} function_t;
+
+typedef struct
+{
+	const char* symbol;
+	position_t at;
+	uint32_t type;
+	int64_t addend;
+} reference_t;
+
+static _Thread_local struct
+{
+	char* code;
+	jump_t* jumps;
+
+	// Where each label is defined, indexed by id. Labels which have not been
+	// defined have an offset of UINT32_MAX.
+	position_t* labels;
+	function_t* functions;
+	reference_t* references;
+
+	// Offset of each jump after layout, which is the sum of the sizes of the
+	// jumps before it.
+	uint32_t* jump_shift;
+} state;
+
+// Sizes of the encodings of a jump.
+#define JUMP_SHORT_SIZE 2
+#define JMP_NEAR_SIZE   5
+#define JCC_NEAR_SIZE   6
+
+static position_t here()
+{
+	position_t at;
+	at.offset = sb_count(state.code);
+	at.jumps = sb_count(state.jumps);
+	return at;
+}
+
+void object_begin()
+{
+	// Buffers keep their capacity for the next object.
+	if(state.code)       stb__sbn(state.code) = 0;
+	if(state.jumps)      stb__sbn(state.jumps) = 0;
+	if(state.labels)     stb__sbn(state.labels) = 0;
+	if(state.functions)  stb__sbn(state.functions) = 0;
+	if(state.references) stb__sbn(state.references) = 0;
+}
+
+void object_bytes(const void* bytes, size_t len)
+{
+	memcpy(sb_add(state.code, len), bytes, len);
+}
+
+void object_byte(uint8_t byte)
+{
+	sb_push(state.code, byte);
+}
+
+void object_imm32(int32_t value)
+{
+	uint32_t v = value;
+	uint8_t bytes[4] = { v, v >> 8, v >> 16, v >> 24 };
+	object_bytes(bytes, 4);
+}
+
+void object_jump(int cond, int label)
+{
+	jump_t jump;
+	jump.at = here();
+	jump.cond = cond;
+	jump.label = label;
+	jump.size = JUMP_SHORT_SIZE;
+	sb_push(state.jumps, jump);
+}
+
+void object_label(int label)
+{
+	while(sb_count(state.labels) <= label)
+	{
+		position_t undefined = { UINT32_MAX, 0 };
+		sb_push(state.labels, undefined);
+	}
+	state.labels[label] = here();
+}
+
+void object_function(const char* name)
+{
+	for(int i = 0; i < sb_count(state.functions); i++)
+	{
+		if(!strcmp(state.functions[i].name, name))
+		{
+			error("redefinition of '%s'\n", name);
+		}
+	}
+
+	function_t function;
+	function.name = name;
+	function.at = here();
+	sb_push(state.functions, function);
+}
+
+void object_reference(const char* symbol, uint32_t type, int64_t addend)
+{
+	reference_t reference;
+	reference.symbol = symbol;
+	reference.at = here();
+	reference.type = type;
+	reference.addend = addend;
+	sb_push(state.references, reference);
+
+	object_imm32(0);
+}
+
+// Returns the final offset of the given position, once jumps are laid out.
+static uint32_t resolve(position_t at)
+{
+	return at.offset + state.jump_shift[at.jumps];
+}
+
+// Returns the final offset of the given label.
+static uint32_t resolve_label(int label)
+{
+	if(label >= sb_count(state.labels) || state.labels[label].offset == UINT32_MAX)
+	{
+		error("jump to undefined label %d\n", label);
+	}
+	return resolve(state.labels[label]);
+}
+
+// Gives every jump the shortest encoding that reaches its target.
+// Every jump starts out short, and any which cannot reach is made near.
+// Growing a jump can only push others out of range, never into it, so
+// this stops once a pass makes no change.
+static void relax()
+{
+	int count = sb_count(state.jumps);
+
+	if(state.jump_shift)
+	{
+		stb__sbn(state.jump_shift) = 0;
+	}
+	(void)sb_add(state.jump_shift, count + 1);
+
+	bool changed = true;
+	while(changed)
+	{
+		changed = false;
+
+		state.jump_shift[0] = 0;
+		for(int i = 0; i < count; i++)
+		{
+			state.jump_shift[i + 1] = state.jump_shift[i] + state.jumps[i].size;
+		}
+
+		for(int i = 0; i < count; i++)
+		{
+			jump_t* jump = &state.jumps[i];
+			if(jump->size != JUMP_SHORT_SIZE)
+			{
+				continue;
+			}
+
+			int64_t end = resolve(jump->at) + jump->size;
+			int64_t displacement = (int64_t)resolve_label(jump->label) - end;
+			if(displacement < INT8_MIN || displacement > INT8_MAX)
+			{
+				jump->size = jump->cond < 0 ? JMP_NEAR_SIZE : JCC_NEAR_SIZE;
+				changed = true;
+			}
+		}
+	}
+}
+
+// Appends the laid out code to the given stretchy buffer.
+static void write_text(char** output)
+{
+	uint32_t offset = 0;
+	for(int i = 0; i < sb_count(state.jumps); i++)
+	{
+		jump_t* jump = &state.jumps[i];
+		memcpy(sb_add(*output, jump->at.offset - offset), state.code + offset, jump->at.offset - offset);
+		offset = jump->at.offset;
+
+		int32_t displacement = resolve_label(jump->label) - (resolve(jump->at) + jump->size);
+		uint8_t bytes[JCC_NEAR_SIZE];
+		int n = 0;
+		if(jump->size == JUMP_SHORT_SIZE)
+		{
+			bytes[n++] = jump->cond < 0 ? 0xeb : 0x70 + jump->cond;
+			bytes[n++] = (int8_t)displacement;
+		}
+		else
+		{
+			if(jump->cond < 0)
+			{
+				bytes[n++] = 0xe9;
+			}
+			else
+			{
+				bytes[n++] = 0x0f;
+				bytes[n++] = 0x80 + jump->cond;
+			}
+			uint32_t d = displacement;
+			bytes[n++] = d;
+			bytes[n++] = d >> 8;
+			bytes[n++] = d >> 16;
+			bytes[n++] = d >> 24;
+		}
+		memcpy(sb_add(*output, n), bytes, n);
+		if(jump->size == JUMP_SHORT_SIZE)
+		{
+			STAT_INC(short_jumps);
+		}
+		else
+		{
+			STAT_INC(near_jumps);
+		}
+	}
+
+	uint32_t rest = sb_count(state.code) - offset;
+	memcpy(sb_add(*output, rest), state.code + offset, rest);
+}
+
+void object_link(char** output)
+{
+	relax();
+
+	uint32_t base = sb_count(*output);
+	write_text(output);
+
+	for(int i = 0; i < sb_count(state.references); i++)
+	{
+		reference_t* reference = &state.references[i];
+		int64_t target = object_function_offset(reference->symbol);
+		if(target < 0 || (reference->type != R_X86_64_PC32 && reference->type != R_X86_64_PLT32))
+		{
+			error("unable to resolve reference to '%s'\n", reference->symbol);
+		}
+
+		// The field holds S + A - P.
+		uint32_t at = resolve(reference->at);
+		uint32_t value = target + reference->addend - at;
+		memcpy(*output + base + at, &value, 4);
+	}
+}
+
+int64_t object_function_offset(const char* name)
+{
+	for(int i = 0; i < sb_count(state.functions); i++)
+	{
+		if(!strcmp(state.functions[i].name, name))
+		{
+			return resolve(state.functions[i].at);
+		}
+	}
+	return -1;
+}
+
+const char* object_function_info(int index, uint32_t* offset)
+{
+	if(index >= sb_count(state.functions))
+	{
+		return NULL;
+	}
+
+	*offset = resolve(state.functions[index].at);
+	return state.functions[index].name;
+}
+
+//
+// ELF output.
+//
+
+// Section header indices.
+enum
+{
+	SECTION_NULL,
+	SECTION_TEXT,
+	SECTION_RELA_TEXT,
+	SECTION_SYMTAB,
+	SECTION_STRTAB,
+	SECTION_SHSTRTAB,
+	SECTION_NOTE_GNU_STACK,
+	SECTION_COUNT
+};
+
+// Appends a NUL terminated string to a string table, returning its offset.
+static uint32_t add_string(char** table, const char* str)
+{
+	uint32_t offset = sb_count(*table);
+	size_t len = strlen(str) + 1;
+	memcpy(sb_add(*table, len), str, len);
+	return offset;
+}
+
+// Pads the buffer with zeroes up to a multiple of 'align' bytes.
+static void align_to(char** buffer, int align)
+{
+	while(sb_count(*buffer) % align)
+	{
+		sb_push(*buffer, 0);
+	}
+}
+
+// Returns the index in the symbol table of the named symbol, adding it as an
+// undefined global if it is not there yet.
+static uint32_t find_symbol(Elf64_Sym** symbols, char** strtab, const char* name)
+{
+	for(int i = 0; i < sb_count(*symbols); i++)
+	{
+		Elf64_Sym* sym = &(*symbols)[i];
+		if(sym->st_name && !strcmp(*strtab + sym->st_name, name))
+		{
+			return i;
+		}
+	}
+
+	Elf64_Sym sym;
+	memset(&sym, 0, sizeof(sym));
+	sym.st_name = add_string(strtab, name);
+	sym.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_NOTYPE);
+	sym.st_shndx = SHN_UNDEF;
+	sb_push(*symbols, sym);
+	return sb_count(*symbols) - 1;
+}
+
+void object_write_elf(char** output)
+{
+	relax();
+
+	char* text = NULL;
+	write_text(&text);
+
+	// Local symbols must come first, there is only the section symbol.
+	char* strtab = NULL;
+	Elf64_Sym* symbols = NULL;
+	sb_push(strtab, '\0');
+
+	Elf64_Sym sym;
+	memset(&sym, 0, sizeof(sym));
+	sb_push(symbols, sym);
+
+	sym.st_info = ELF64_ST_INFO(STB_LOCAL, STT_SECTION);
+	sym.st_shndx = SECTION_TEXT;
+	sb_push(symbols, sym);
+
+	int first_global = sb_count(symbols);
+	for(int i = 0; i < sb_count(state.functions); i++)
+	{
+		uint32_t start = resolve(state.functions[i].at);
+		uint32_t end = i + 1 < sb_count(state.functions) ? resolve(state.functions[i + 1].at) : (uint32_t)sb_count(text);
+
+		memset(&sym, 0, sizeof(sym));
+		sym.st_name = add_string(&strtab, state.functions[i].name);
+		sym.st_info = ELF64_ST_INFO(STB_GLOBAL, STT_FUNC);
+		sym.st_shndx = SECTION_TEXT;
+		sym.st_value = start;
+		sym.st_size = end - start;
+		sb_push(symbols, sym);
+	}
+
+	Elf64_Rela* relocations = NULL;
+	for(int i = 0; i < sb_count(state.references); i++)
+	{
+		reference_t* reference = &state.references[i];
+
+		Elf64_Rela rela;
+		rela.r_offset = resolve(reference->at);
+		rela.r_info = ELF64_R_INFO(find_symbol(&symbols, &strtab, reference->symbol), reference->type);
+		rela.r_addend = reference->addend;
+		sb_push(relocations, rela);
+	}
+
+	char* shstrtab = NULL;
+	uint32_t section_names[SECTION_COUNT] = { 0 };
+	sb_push(shstrtab, '\0');
+	section_names[SECTION_TEXT] = add_string(&shstrtab, ".text");
+	section_names[SECTION_RELA_TEXT] = add_string(&shstrtab, ".rela.text");
+	section_names[SECTION_SYMTAB] = add_string(&shstrtab, ".symtab");
+	section_names[SECTION_STRTAB] = add_string(&shstrtab, ".strtab");
+	section_names[SECTION_SHSTRTAB] = add_string(&shstrtab, ".shstrtab");
+	section_names[SECTION_NOTE_GNU_STACK] = add_string(&shstrtab, ".note.GNU-stack");
+
+	Elf64_Shdr sections[SECTION_COUNT];
+	memset(sections, 0, sizeof(sections));
+
+	// The sections follow the ELF header, and the section headers come last.
+	char* file = NULL;
+	(void)sb_add(file, sizeof(Elf64_Ehdr));
+
+	align_to(&file, 16);
+	Elf64_Shdr* s = &sections[SECTION_TEXT];
+	s->sh_type = SHT_PROGBITS;
+	s->sh_flags = SHF_ALLOC | SHF_EXECINSTR;
+	s->sh_offset = sb_count(file);
+	s->sh_size = sb_count(text);
+	s->sh_addralign = 16;
+	memcpy(sb_add(file, sb_count(text)), text, sb_count(text));
+
+	align_to(&file, 8);
+	s = &sections[SECTION_RELA_TEXT];
+	s->sh_type = SHT_RELA;
+	s->sh_flags = SHF_INFO_LINK;
+	s->sh_offset = sb_count(file);
+	s->sh_size = sb_count(relocations) * sizeof(Elf64_Rela);
+	s->sh_link = SECTION_SYMTAB;
+	s->sh_info = SECTION_TEXT;
+	s->sh_addralign = 8;
+	s->sh_entsize = sizeof(Elf64_Rela);
+	memcpy(sb_add(file, s->sh_size), relocations, s->sh_size);
+
+	s = &sections[SECTION_SYMTAB];
+	s->sh_type = SHT_SYMTAB;
+	s->sh_offset = sb_count(file);
+	s->sh_size = sb_count(symbols) * sizeof(Elf64_Sym);
+	s->sh_link = SECTION_STRTAB;
+	s->sh_info = first_global;
+	s->sh_addralign = 8;
+	s->sh_entsize = sizeof(Elf64_Sym);
+	memcpy(sb_add(file, s->sh_size), symbols, s->sh_size);
+
+	s = &sections[SECTION_STRTAB];
+	s->sh_type = SHT_STRTAB;
+	s->sh_offset = sb_count(file);
+	s->sh_size = sb_count(strtab);
+	s->sh_addralign = 1;
+	memcpy(sb_add(file, s->sh_size), strtab, s->sh_size);
+
+	s = &sections[SECTION_SHSTRTAB];
+	s->sh_type = SHT_STRTAB;
+	s->sh_offset = sb_count(file);
+	s->sh_size = sb_count(shstrtab);
+	s->sh_addralign = 1;
+	memcpy(sb_add(file, s->sh_size), shstrtab, s->sh_size);
+
+	// An empty note marks the stack as non-executable.
+	s = &sections[SECTION_NOTE_GNU_STACK];
+	s->sh_type = SHT_PROGBITS;
+	s->sh_offset = sb_count(file);
+	s->sh_addralign = 1;
+
+	for(int i = 0; i < SECTION_COUNT; i++)
+	{
+		sections[i].sh_name = section_names[i];
+	}
+
+	align_to(&file, 8);
+	uint64_t section_offset = sb_count(file);
+	memcpy(sb_add(file, sizeof(sections)), sections, sizeof(sections));
+
+	Elf64_Ehdr* header = (Elf64_Ehdr*)file;
+	memset(header, 0, sizeof(Elf64_Ehdr));
+	memcpy(header->e_ident, ELFMAG, SELFMAG);
+	header->e_ident[EI_CLASS] = ELFCLASS64;
+	header->e_ident[EI_DATA] = ELFDATA2LSB;
+	header->e_ident[EI_VERSION] = EV_CURRENT;
+	header->e_ident[EI_OSABI] = ELFOSABI_SYSV;
+	header->e_type = ET_REL;
+	header->e_machine = EM_X86_64;
+	header->e_version = EV_CURRENT;
+	header->e_shoff = section_offset;
+	header->e_ehsize = sizeof(Elf64_Ehdr);
+	header->e_shentsize = sizeof(Elf64_Shdr);
+	header->e_shnum = SECTION_COUNT;
+	header->e_shstrndx = SECTION_SHSTRTAB;
+
+	memcpy(sb_add(*output, sb_count(file)), file, sb_count(file));
+
+	sb_free(file);
+	sb_free(text);
+	sb_free(strtab);
+	sb_free(shstrtab);
+	sb_free(symbols);
+	sb_free(relocations);
+}
@@ -0,0 +1,64 @@
+#ifndef _OBJECT_H
+#define _OBJECT_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Machine code being assembled into an object file.
+//
+// Code is appended a few bytes at a time, while jumps and the labels they
+// target are recorded separately. Once all of the code has been added, every
+// jump is given the shortest encoding which reaches its target, and the
+// result is written out as an ELF64 relocatable object.
+//
+// Each thread has its own object.
+
+// Discards any previous object and starts a new, empty one.
+void object_begin();
+
+// Appends 'len' bytes of code.
+void object_bytes(const void* bytes, size_t len);
+
+// Appends a single byte of code.
+void object_byte(uint8_t byte);
+
+// Appends a 32-bit little endian value.
+void object_imm32(int32_t value);
+
+// Appends a jump to the given label. 'cond' is the condition code of a
+// 'Jcc', or -1 for an unconditional 'jmp'.
+void object_jump(int cond, int label);
+
+// Defines the label with the given id at the current position.
+void object_label(int label);
+
+// Defines a global function at the current position. A function extends
+// to the start of the next one, or to the end of the code.
+void object_function(const char* name);
+
+// Appends a 4 byte field which the linker fills in with the address of the
+// named symbol, using the given x86-64 relocation type and addend. The
+// symbol may be defined in this object or elsewhere.
+void object_reference(const char* symbol, uint32_t type, int64_t addend);
+
+// Lays out the code, and appends the resulting ELF relocatable object to the
+// given stretchy buffer.
+// If a jump targets a label which was never defined, the program will
+// terminate and an error message will be printed to the user.
+void object_write_elf(char** output);
+
+// Lays out the code as it would be placed in memory, and appends it to the
+// given stretchy buffer. PC-relative references to functions defined in the
+// object are filled in, any other reference is an error.
+void object_link(char** output);
+
+// Returns the offset of the named function in the code laid out by the last
+// call to 'object_link()', or -1 if the object does not define it.
+int64_t object_function_offset(const char* name);
+
+// Returns the name of the function with the given index, in the order they
+// were defined, or NULL once there are no more. Its offset in the code laid
+// out by the last call to 'object_link()' is stored in 'offset'.
+const char* object_function_info(int index, uint32_t* offset);
+
+#endif
@@ -1,46 +1,152 @@
 #include "parser.h"
+#include "lex.h"
+#include "stats.h"
 
-// Global state for the parser.
+// Number of tokens the parser can see ahead of its current position.
+#define PARSER_LOOKAHEAD 2
+
+// State for the parser, each thread has its own.
 // The state is reset with each call to 'parse()'.
-static struct
+static _Thread_local struct
 {
+	// Token list being parsed, or NULL when tokens are pulled straight from
+	// the lexer.
 	token_t* tokens;
 	int ptr;
+
+	// The next tokens in the input stream, window[0] is the current token.
+	token_t window[PARSER_LOOKAHEAD];
+
+	// Running hash of the tokens consumed so far.
+	uint64_t token_hash;
+
+	// Arena that new nodes are allocated from.
+	arena_t* arena;
+
+	// Backing storage for the program being built by 'parse()'.
+	arena_t program;
+
+	// Elements of the lists currently being parsed. Lists nest, so each one
+	// is stacked on top of the list which contains it.
+	void** lists;
+
+	// Backing storage for nodes returned by '_parse_expression()' and
+	// '_parse_statement()'.
+	arena_t scratch;
+
+	// Backing storage for the declaration returned by 'parse_next_decl()'.
+	arena_t stream;
 } state;
 
 //
 // State modifiers.
 //
 
+// Reads a new token from the underlying token source.
+// Once the end of the input is reached, every call returns TKN_EOF.
+static token_t pull()
+{
+	if(state.tokens == NULL)
+	{
+		return lex_next();
+	}
+
+	token_t token = state.tokens[state.ptr];
+	if(token.type != TKN_EOF)
+	{
+		state.ptr++;
+	}
+	return token;
+}
+
+// Resets the state to begin parsing from the given token list, or from the
+// lexer if 'tokens' is NULL.
+static void reset(token_t* tokens)
+{
+	state.tokens = tokens;
+	state.ptr = 0;
+
+	// Lists left over from parsing which was abandoned by an error.
+	if(state.lists)
+	{
+		stb__sbn(state.lists) = 0;
+	}
+
+	for(int i = 0; i < PARSER_LOOKAHEAD; i++)
+	{
+		state.window[i] = pull();
+	}
+}
+
 // Returns true if there are more tokens to be read from the input, false otherwise.
 static bool has_next()
 {
-	return state.tokens[state.ptr].type != TKN_EOF;
+	return state.window[0].type != TKN_EOF;
 }
 
 // Returns the next token in the input stream, does not increment the pointer.
 static token_t peek()
 {
-	return state.tokens[state.ptr];
+	return state.window[0];
+}
+
+// Returns the type of the token 'n' places after the next token in the input
+// stream, 'n' must be less than PARSER_LOOKAHEAD.
+static token_type_t peek_ahead(int n)
+{
+	return state.window[n].type;
 }
 
-// Returns the next token in the input stream, increments the internal pointer
-// to point to the next token.
+// 64-bit FNV-1a.
+#define FNV_OFFSET_BASIS 14695981039346656037ull
+#define FNV_PRIME 1099511628211ull
+
+// Folds 'len' bytes into the running token hash.
+static void hash_bytes(const void* bytes, size_t len)
+{
+	const unsigned char* p = bytes;
+	uint64_t hash = state.token_hash;
+	for(size_t i = 0; i < len; i++)
+	{
+		hash ^= p[i];
+		hash *= FNV_PRIME;
+	}
+	state.token_hash = hash;
+}
+
+// Folds a token into the running token hash. Names are hashed by their
+// contents, as interned pointers differ from run to run.
+static void hash_token(token_t token)
+{
+	uint8_t type = token.type;
+	hash_bytes(&type, 1);
+
+	switch(token.type)
+	{
+	case TKN_INTEGER: hash_bytes(&token.val_integer, sizeof(token.val_integer)); break;
+	case TKN_IDENT:   hash_bytes(token.val_string, strlen(token.val_string) + 1); break;
+	default: break;
+	}
+}
+
+// Returns the next token in the input stream, advancing the window by one.
 static token_t next()
 {
-	return state.tokens[state.ptr++];
+	token_t token = state.window[0];
+	hash_token(token);
+	for(int i = 0; i < PARSER_LOOKAHEAD - 1; i++)
+	{
+		state.window[i] = state.window[i + 1];
+	}
+	state.window[PARSER_LOOKAHEAD - 1] = pull();
+	return token;
 }
 
 // Returns true if the next token in the stream is of the specified type, false
 // otherwise. Does not increment the internal pointer.
 static bool match(token_type_t type)
 {
-	return peek().type == type;
-}
-
-static void prev()
-{
-	state.ptr--;
+	return state.window[0].type == type;
 }
 
 // Returns the next token in the stream if that token matches the specified
@@ -63,7 +169,9 @@ static token_t expect(token_type_t type)
 // Allocates a new expression with the given type.
 static expr_t* new_expr(expr_type_t type)
 {
-	expr_t* expr = calloc(1, sizeof(expr_t));
+	STAT_INC(exprs[type]);
+
+	expr_t* expr = arena_alloc(state.arena, sizeof(expr_t));
 	expr->type = type;
 	return expr;
 }
@@ -71,7 +179,9 @@ static expr_t* new_expr(expr_type_t type)
 // Allocates a new statement with the given type.
 static stmt_t* new_stmt(stmt_type_t type)
 {
-	stmt_t* stmt = calloc(1, sizeof(stmt_t));
+	STAT_INC(stmts[type]);
+
+	stmt_t* stmt = arena_alloc(state.arena, sizeof(stmt_t));
 	stmt->type = type;
 	return stmt;
 }
@@ -79,42 +189,95 @@ static stmt_t* new_stmt(stmt_type_t type)
 // Allocates a new declaration with the given type.
 static decl_t* new_decl(decl_type_t type)
 {
-	decl_t* decl = calloc(1, sizeof(decl_t));
+	STAT_INC(decls[type]);
+
+	decl_t* decl = arena_alloc(state.arena, sizeof(decl_t));
 	decl->type = type;
 	decl->stmts = NULL;
+	decl->stmt_count = 0;
 	return decl;
 }
 
 // Allocates a new program.
 static program_t* new_program()
 {
-	program_t* program = calloc(1, sizeof(program_t));
+	program_t* program = arena_alloc(state.arena, sizeof(program_t));
 	return program;
 }
 
+// Starts a new list on the list stack, returning its base for 'list_end()'.
+static int list_begin()
+{
+	return sb_count(state.lists);
+}
+
+// Appends an element to the list at the top of the stack.
+static void list_push(void* element)
+{
+	sb_push(state.lists, element);
+}
+
+// Moves the list starting at 'base' off the stack and into the arena.
+static void** list_end(int base, int* count)
+{
+	*count = sb_count(state.lists) - base;
+	if(*count == 0)
+	{
+		return NULL;
+	}
+
+	void** copy = arena_alloc(state.arena, *count * sizeof(void*));
+	memcpy(copy, state.lists + base, *count * sizeof(void*));
+	stb__sbn(state.lists) = base;
+	return copy;
+}
+
 //
 // Parser body.
 //
 
-static expr_t* parse_expr0();
-static expr_t* parse_expr1();
-static expr_t* parse_expr2();
-static expr_t* parse_expr3();
-static expr_t* parse_expr4();
-static expr_t* parse_expr5();
-static expr_t* parse_expr6();
-static expr_t* parse_expr7();
-static expr_t* parse_expr8();
-static expr_t* parse_expr9();
-static expr_t* parse_expr10();
-static expr_t* parse_expr11();
-
-// Parses an expression from the input stream.
-// <"!" | "~" | "-"> <expr> | "(" <expr> ")" | integer
-static expr_t* parse_expr0()
+// Binding information for a binary operator token.
+typedef struct
+{
+	// Tokens with a precedence of 0 are not binary operators, all other
+	// operators bind more tightly the higher their precedence.
+	int precedence;
+	binary_operator_t operator;
+} binary_info_t;
+
+// Binary operator table indexed by token type. Every binary operator is
+// left associative.
+static const binary_info_t binary_info[TKN_EOF + 1] =
 {
-	if(match(TKN_INTEGER))
+	[TKN_ASTERIX  ] = { 10, BINARY_MUL         },
+	[TKN_SLASH    ] = { 10, BINARY_DIV         },
+	[TKN_MODULO   ] = { 10, BINARY_MODULO      },
+	[TKN_PLUS     ] = {  9, BINARY_ADD         },
+	[TKN_MINUS    ] = {  9, BINARY_SUB         },
+	[TKN_LT_LT    ] = {  8, BINARY_SHIFT_LEFT  },
+	[TKN_GT_GT    ] = {  8, BINARY_SHIFT_RIGHT },
+	[TKN_LT       ] = {  7, BINARY_LESS        },
+	[TKN_LT_EQ    ] = {  7, BINARY_LESS_EQ     },
+	[TKN_GT       ] = {  7, BINARY_GRTR        },
+	[TKN_GT_EQ    ] = {  7, BINARY_GRTR_EQ     },
+	[TKN_EQ_EQ    ] = {  6, BINARY_EQUALS      },
+	[TKN_NOT_EQ   ] = {  6, BINARY_NOT_EQ      },
+	[TKN_AMP      ] = {  5, BINARY_BITWISE_AND },
+	[TKN_CARET    ] = {  4, BINARY_BITWISE_XOR },
+	[TKN_PIPE     ] = {  3, BINARY_BITWISE_OR  },
+	[TKN_AMP_AMP  ] = {  2, BINARY_LOGICAL_AND },
+	[TKN_PIPE_PIPE] = {  1, BINARY_LOGICAL_OR  }
+};
+
+static expr_t* parse_expression();
+
+// Parses a unary expression from the input stream.
+// unary = <"!" | "~" | "-"> <unary> | "(" <expr> ")" | integer | name
+static expr_t* parse_unary()
+{
+	switch(state.window[0].type)
 	{
+	case TKN_INTEGER: {
 		// If we got an integer, return a constant node.
 		token_t t = next();
 
@@ -122,10 +285,9 @@ static expr_t* parse_expr0()
 		expr->value = t.val_integer;
 		return expr;
 	}
-	else if(match(TKN_MINUS)
-		 || match(TKN_TILDE)
-		 || match(TKN_BANG))
-	{
+	case TKN_MINUS:
+	case TKN_TILDE:
+	case TKN_BANG: {
 		// If we got a unary operator, parse it.
 		token_t t = next();
 
@@ -135,10 +297,8 @@ static expr_t* parse_expr0()
 		if(t.type == TKN_TILDE) { operator = UNARY_BITWISE_COMPLEMENT; }
 		if(t.type == TKN_BANG ) { operator = UNARY_LOGICAL_NEGATE;     }
 
-		if(operator == UNARY_UNKNOWN) { UNHANDLED_CASE(); }
-
 		// Recursively parse the operand.
-		expr_t* operand = parse_expr0();
+		expr_t* operand = parse_unary();
 
 		// Construct the unary expression.
 		expr_t* expr = new_expr(EXPR_UNARY);
@@ -146,315 +306,78 @@ static expr_t* parse_expr0()
 		expr->unary_operand = operand;
 		return expr;
 	}
-	else if(match(TKN_L_PAREN))
-	{
+	case TKN_L_PAREN: {
 		// Recurse back to the bottom, parsing an new expression from scratch.
 		expect(TKN_L_PAREN);
-		expr_t* expr = parse_expr11();
+		expr_t* expr = parse_expression();
 		expect(TKN_R_PAREN);
 		return expr;
 	}
-	else if(match(TKN_IDENT))
-	{
+	case TKN_IDENT: {
 		token_t t = expect(TKN_IDENT);
 		expr_t* expr = new_expr(EXPR_VAR);
 		expr->var_name = t.val_string;
 		return expr;
 	}
-	else
-	{
+	default: {
 		error("expected an expression\n");
 	}
-}
-
-// expr1 = <expr0> { ("*" | "/" | "%") <expr0> }
-static expr_t* parse_expr1()
-{
-	expr_t* lhs = parse_expr0();
-	while(match(TKN_ASTERIX)
-	   || match(TKN_SLASH)
-	   || match(TKN_MODULO))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr0();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_ASTERIX) { operator = BINARY_MUL;    }
-		if(t.type == TKN_SLASH  ) { operator = BINARY_DIV;    }
-		if(t.type == TKN_MODULO ) { operator = BINARY_MODULO; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
-	}
-	return lhs;
-}
-
-// expr2 = <expr1> { ("+" | "-") <expr1> }
-static expr_t* parse_expr2()
-{
-	expr_t* lhs = parse_expr1();
-	while(match(TKN_PLUS)
-	   || match(TKN_MINUS))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr1();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_PLUS ) { operator = BINARY_ADD; }
-		if(t.type == TKN_MINUS) { operator = BINARY_SUB; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
-	}
-	return lhs;
-}
-
-// expr3 = <expr2> { "<<" ">>" <expr2> }
-static expr_t* parse_expr3()
-{
-	expr_t* lhs = parse_expr2();
-	while(match(TKN_LT_LT)
-	   || match(TKN_GT_GT))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr2();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_LT_LT) { operator = BINARY_SHIFT_LEFT;  }
-		if(t.type == TKN_GT_GT) { operator = BINARY_SHIFT_RIGHT; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
 	}
-	return lhs;
 }
 
-// expr4 = <expr3> { ("<" | "<=" | ">" | ">=") <expr3> }
-static expr_t* parse_expr4()
+// Parses a chain of binary operators whose precedence is at least
+// 'min_precedence' using precedence climbing.
+// binary = <unary> { operator <binary> }
+static expr_t* parse_binary(int min_precedence)
 {
-	expr_t* lhs = parse_expr3();
-	while(match(TKN_GT)
-	   || match(TKN_GT_EQ)
-	   || match(TKN_LT)
-	   || match(TKN_LT_EQ))
+	expr_t* lhs = parse_unary();
+	for(;;)
 	{
-		token_t t = next();
-		expr_t* rhs = parse_expr3();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_GT   ) { operator = BINARY_GRTR;    }
-		if(t.type == TKN_GT_EQ) { operator = BINARY_GRTR_EQ; }
-		if(t.type == TKN_LT   ) { operator = BINARY_LESS;    }
-		if(t.type == TKN_LT_EQ) { operator = BINARY_LESS_EQ; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
-	}
-	return lhs;
-}
-
-// expr5 = <expr4> { ("!=" | "==") <expr4> }
-static expr_t* parse_expr5()
-{
-	// != ==
-	expr_t* lhs = parse_expr4();
-	while(match(TKN_EQ_EQ)
-	   || match(TKN_NOT_EQ))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr4();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_EQ_EQ ) { operator = BINARY_EQUALS; }
-		if(t.type == TKN_NOT_EQ) { operator = BINARY_NOT_EQ; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
-	}
-	return lhs;
-}
-
-// expr6 = <expr5> { "&" <expr5> }
-static expr_t* parse_expr6()
-{
-	expr_t* lhs = parse_expr5();
-	while(match(TKN_AMP))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr5();
-
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_AMP) { operator = BINARY_BITWISE_AND; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
-	}
-	return lhs;
-}
-
-// expr7 = <expr6> { "^" <expr6> }
-static expr_t* parse_expr7()
-{
-	expr_t* lhs = parse_expr6();
-	while(match(TKN_CARET))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr6();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_CARET) { operator = BINARY_BITWISE_XOR; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
-	}
-	return lhs;
-}
-
-// expr8 = <expr7> { "|" <expr7> }
-static expr_t* parse_expr8()
-{
-	expr_t* lhs = parse_expr7();
-	while(match(TKN_PIPE))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr7();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_PIPE) { operator = BINARY_BITWISE_OR; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
-	}
-	return lhs;
-}
-
-// expr9 = <expr8> { "&&" <expr8> }
-static expr_t* parse_expr9()
-{
-	expr_t* lhs = parse_expr8();
-	while(match(TKN_AMP_AMP))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr8();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_AMP_AMP) { operator = BINARY_LOGICAL_AND; }
-
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
-
-		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
-		expr->binary_lhs = lhs;
-		expr->binary_rhs = rhs;
-		lhs = expr;
-	}
-	return lhs;
-}
-
-// expr10 = <expr9> { "||" <expr9> }
-static expr_t* parse_expr10()
-{
-	expr_t* lhs = parse_expr9();
-	while(match(TKN_PIPE_PIPE))
-	{
-		token_t t = next();
-		expr_t* rhs = parse_expr9();
-
-		// Deduce the operator from the token.
-		binary_operator_t operator = BINARY_UNKNOWN;
-		if(t.type == TKN_PIPE_PIPE) { operator = BINARY_LOGICAL_OR; }
+		const binary_info_t* info = &binary_info[state.window[0].type];
+		if(info->precedence < min_precedence)
+		{
+			return lhs;
+		}
+		next();
 
-		if(operator == BINARY_UNKNOWN) { UNHANDLED_CASE(); }
+		// Operators are left associative, so the right hand side may only
+		// contain operators which bind more tightly than this one.
+		expr_t* rhs = parse_binary(info->precedence + 1);
 
 		expr_t* expr = new_expr(EXPR_BINARY);
-		expr->binary_operator = operator;
+		expr->binary_operator = info->operator;
 		expr->binary_lhs = lhs;
 		expr->binary_rhs = rhs;
 		lhs = expr;
 	}
-	return lhs;
 }
 
-// expr11 = (name "=" <expr11>) | <expr10>
-static expr_t* parse_expr11()
+// Parses an expression from the input stream.
+// expr = (name "=" <expr>) | <binary>
+static expr_t* parse_expression()
 {
-	if(match(TKN_IDENT))
+	// An identifier is only the target of an assignment if it is followed by
+	// an '=', otherwise it is the start of a regular expression.
+	if(match(TKN_IDENT) && peek_ahead(1) == TKN_EQ)
 	{
 		token_t name = expect(TKN_IDENT);
-		if(match(TKN_EQ))
-		{
-			expect(TKN_EQ);
-			expr_t* stmt = new_expr(EXPR_ASSIGNMENT);
-			stmt->assign_name = name.val_string;
-			stmt->assign_rhs = parse_expr11();
-			return stmt;
-		}
-		else
-		{
-			// If we don't get an '=' after the identifier, revert back to before
-			// the identifier and continue to parse and expression.
-			prev();
-		}
+		expect(TKN_EQ);
+		expr_t* stmt = new_expr(EXPR_ASSIGNMENT);
+		stmt->assign_name = name.val_string;
+		stmt->assign_rhs = parse_expression();
+		return stmt;
 	}
-	return parse_expr10();
+	return parse_binary(1);
 }
 
 // Parses a statement from the input stream.
-// stmt = "return" <expr11> ";"
+// stmt = "return" <expr> ";"
 static stmt_t* parse_statement()
 {
 	if(match(TKN_RETURN))
 	{
 		expect(TKN_RETURN);
-		expr_t* expr = parse_expr11();
+		expr_t* expr = parse_expression();
 		expect(TKN_SEMICOLON);
 		stmt_t* stmt = new_stmt(STMT_RETURN);
 		stmt->return_expr = expr;
@@ -473,7 +396,7 @@ static stmt_t* parse_statement()
 			if(match(TKN_EQ))
 			{
 				expect(TKN_EQ);
-				initializer = parse_expr11();
+				initializer = parse_expression();
 			}
 			expect(TKN_SEMICOLON);
 
@@ -486,7 +409,7 @@ static stmt_t* parse_statement()
 
 	// If we didn't match any valid statement, then we are parsing a standalone
 	// expression.
-	expr_t* expr = parse_expr11();
+	expr_t* expr = parse_expression();
 	expect(TKN_SEMICOLON);
 	stmt_t* stmt = new_stmt(STMT_EXPR);
 	stmt->standalone_expr = expr;
@@ -497,6 +420,8 @@ static stmt_t* parse_statement()
 // decl = "int" identifier "(" ")" "{" { <stmt> } "}"
 static decl_t* parse_declaration()
 {
+	state.token_hash = FNV_OFFSET_BASIS;
+
 	token_t ret = expect(TKN_IDENT);
 	// only support int types
 	if(ret.val_string != _("int"))
@@ -509,11 +434,10 @@ static decl_t* parse_declaration()
 	expect(TKN_R_PAREN);
 	expect(TKN_L_CURLY);
 
-	stmt_t** stmts = NULL;
+	int stmts = list_begin();
 	while(!match(TKN_R_CURLY))
 	{
-		stmt_t* stmt = parse_statement();
-        sb_push(stmts, stmt);
+		list_push(parse_statement());
 	}
 
 	expect(TKN_R_CURLY);
@@ -521,20 +445,25 @@ static decl_t* parse_declaration()
 	// For now we only support function delcarations.
 	// In the future we will support other types of declarations.
 	decl_t* decl = new_decl(DECL_FUNC);
+	decl->token_hash = state.token_hash;
 	decl->name = name.val_string;
-	decl->stmts = stmts;
+	decl->stmts = (stmt_t**)list_end(stmts, &decl->stmt_count);
 
 	return decl;
 }
 
 // Parses a program from the input stream.
-// program = <decl>
+// program = { <decl> }
 static program_t* parse_program()
 {
-	decl_t* decl = parse_declaration();
+	int decls = list_begin();
+	while(has_next())
+	{
+		list_push(parse_declaration());
+	}
 
 	program_t* program = new_program();
-	program->decl = decl;
+	program->decls = (decl_t**)list_end(decls, &program->decl_count);
 	return program;
 }
 
@@ -544,24 +473,88 @@ static program_t* parse_program()
 
 program_t* parse(token_t* tokens)
 {
-	state.tokens = tokens;
-	state.ptr = 0;
+	reset(tokens);
+
+	// Nodes are allocated into a fresh arena which is handed over to the
+	// program once parsing is complete. An arena which was never handed
+	// over belongs to a parse which was abandoned by an error.
+	arena_release(&state.program);
+	state.arena = &state.program;
+
+	program_t* program = parse_program();
+	program->arena = state.program;
+	memset(&state.program, 0, sizeof(arena_t));
+
+	state.arena = NULL;
+	return program;
+}
+
+void free_program(program_t* program)
+{
+	// The program itself lives in its arena, so take a copy first.
+	arena_t arena = program->arena;
+	arena_release(&arena);
+}
+
+void parse_begin()
+{
+	reset(NULL);
+}
+
+decl_t* parse_next_decl()
+{
+	// The previous declaration is no longer needed, its block is kept for
+	// the next one.
+	arena_reset(&state.stream);
+
+	if(!has_next())
+	{
+		return NULL;
+	}
 
-	return parse_program();
+	state.arena = &state.stream;
+	decl_t* decl = parse_declaration();
+	state.arena = NULL;
+	return decl;
 }
 
 expr_t* _parse_expression(token_t* tokens)
 {
-	state.tokens = tokens;
-	state.ptr = 0;
+	reset(tokens);
 
-	return parse_expr11();
+	arena_reset(&state.scratch);
+	state.arena = &state.scratch;
+
+	return parse_expression();
 }
 
 stmt_t* _parse_statement(token_t* tokens)
 {
-	state.tokens = tokens;
-	state.ptr = 0;
+	reset(tokens);
+
+	arena_reset(&state.scratch);
+	state.arena = &state.scratch;
 
 	return parse_statement();
-}
\ No newline at end of file
+}
+
+decl_t* _parse_statements(token_t* tokens)
+{
+	reset(tokens);
+
+	arena_reset(&state.scratch);
+	state.arena = &state.scratch;
+	state.token_hash = FNV_OFFSET_BASIS;
+
+	int stmts = list_begin();
+	while(has_next())
+	{
+		list_push(parse_statement());
+	}
+
+	decl_t* decl = new_decl(DECL_FUNC);
+	decl->token_hash = state.token_hash;
+	decl->name = NULL;
+	decl->stmts = (stmt_t**)list_end(stmts, &decl->stmt_count);
+	return decl;
+}
@@ -7,6 +7,7 @@
 #include "buf.h"
 #include "str.h"
 #include "error.h"
+#include "arena.h"
 
 typedef enum
 {
@@ -52,6 +53,10 @@ typedef struct expr_t
 {
 	expr_type_t type;
 
+	// Number of registers needed to evaluate the expression without spilling
+	// to the stack, filled in by the generator.
+	int registers;
+
 	union
 	{
 		struct
@@ -119,19 +124,28 @@ typedef struct
 {
 	decl_type_t type;
 
+	// Hash of every token the declaration was parsed from. Declarations with
+	// the same tokens have the same hash on every run.
+	uint64_t token_hash;
+
 	union
 	{
 		struct
 		{ // DECL_FUNC
 			str_t name;
 			stmt_t** stmts;
+			int stmt_count;
 		};
 	};
 } decl_t;
 
 typedef struct
 {
-	decl_t* decl;
+	decl_t** decls;
+	int decl_count;
+
+	// Every node reachable from this program is allocated from this arena.
+	arena_t arena;
 } program_t;
 
 // Parses the given input, returning the root of the AST.
@@ -139,10 +153,33 @@ typedef struct
 // error message will be printed to the user.
 program_t* parse(token_t* tokens);
 
+// Releases the given program along with its entire AST.
+void free_program(program_t* program);
+
+// Begins parsing top-level declarations one at a time, pulling tokens
+// straight from the lexer. The lexer must already have been started with
+// 'lex_begin()'.
+void parse_begin();
+
+// Parses the next top-level declaration from the lexer, returning NULL once
+// the end of the input has been reached.
+// The result is only valid until the next call to 'parse_next_decl()'.
+decl_t* parse_next_decl();
+
 // Parses a single expression from given token list.
+// The result is only valid until the next call to '_parse_expression()',
+// '_parse_statement()' or '_parse_statements()'.
 expr_t* _parse_expression(token_t* tokens);
 
 // Parses a single statement from given token list.
+// The result is only valid until the next call to '_parse_expression()',
+// '_parse_statement()' or '_parse_statements()'.
 stmt_t* _parse_statement(token_t* tokens);
 
+// Parses every statement in the given token list as the body of a function,
+// whose name is left NULL for the caller to fill in.
+// The result is only valid until the next call to '_parse_expression()',
+// '_parse_statement()' or '_parse_statements()'.
+decl_t* _parse_statements(token_t* tokens);
+
 #endif
@@ -0,0 +1,223 @@
+#include "regalloc.h"
+#include "stats.h"
+
+typedef struct
+{
+	str_t name;
+
+	// Positions are counted in half statements: the expressions of statement
+	// 'i' are evaluated at 2i, and a variable it declares is stored at 2i + 1.
+	int start;
+	int end;
+
+	bool assigned;
+	bool literal_initializer;
+	int32_t value;
+} interval_t;
+
+static _Thread_local struct
+{
+	// Stretchy buffers, their capacity is kept for the next function.
+	interval_t* intervals;
+	int* active;
+} state;
+
+// Records a reference to the named variable at the given position. Names
+// refer to the first variable declared with them, as in the generator, and
+// a name which has not been declared yet is left for the generator to
+// report.
+static void note_reference(str_t name, int position, bool assignment)
+{
+	for(int i = 0; i < sb_count(state.intervals); i++)
+	{
+		interval_t* interval = &state.intervals[i];
+		if(interval->name == name)
+		{
+			interval->end = position;
+			interval->assigned |= assignment;
+			return;
+		}
+	}
+}
+
+static void note_expr(expr_t* expr, int position)
+{
+	switch(expr->type)
+	{
+	case EXPR_LITERAL: {
+	} break;
+	case EXPR_UNARY: {
+		note_expr(expr->unary_operand, position);
+	} break;
+	case EXPR_BINARY: {
+		note_expr(expr->binary_lhs, position);
+		note_expr(expr->binary_rhs, position);
+	} break;
+	case EXPR_ASSIGNMENT: {
+		note_expr(expr->assign_rhs, position);
+		note_reference(expr->assign_name, position, true);
+	} break;
+	case EXPR_VAR: {
+		note_reference(expr->var_name, position, false);
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+// Builds the live interval of every variable the function declares.
+static void build_intervals(decl_t* decl)
+{
+	for(int i = 0; i < decl->stmt_count; i++)
+	{
+		stmt_t* stmt = decl->stmts[i];
+		switch(stmt->type)
+		{
+		case STMT_EXPR: {
+			note_expr(stmt->standalone_expr, 2 * i);
+		} break;
+		case STMT_RETURN: {
+			note_expr(stmt->return_expr, 2 * i);
+		} break;
+		case STMT_DECLARE: {
+			interval_t interval = { 0 };
+			interval.name = stmt->declare_name;
+			interval.start = 2 * i + 1;
+			interval.end = 2 * i + 1;
+
+			expr_t* initializer = stmt->declare_initializer;
+			if(initializer)
+			{
+				note_expr(initializer, 2 * i);
+				if(initializer->type == EXPR_LITERAL)
+				{
+					interval.literal_initializer = true;
+					interval.value = (int32_t)initializer->value;
+				}
+			}
+			sb_push(state.intervals, interval);
+		} break;
+		default: {
+			UNHANDLED_CASE();
+		} break;
+		}
+	}
+}
+
+// Removes an interval from the active list, which is kept sorted by end.
+static void remove_active(int index)
+{
+	int count = sb_count(state.active);
+	for(int i = index; i < count - 1; i++)
+	{
+		state.active[i] = state.active[i + 1];
+	}
+	stb__sbn(state.active)--;
+}
+
+// Adds an interval to the active list, keeping it sorted by end.
+static void insert_active(int interval)
+{
+	sb_push(state.active, interval);
+	int i = sb_count(state.active) - 1;
+	while(i > 0 && state.intervals[state.active[i - 1]].end > state.intervals[interval].end)
+	{
+		state.active[i] = state.active[i - 1];
+		i--;
+	}
+	state.active[i] = interval;
+}
+
+uint32_t regalloc_function(decl_t* decl, const reg_t* registers, int register_count, var_allocation_t** allocations)
+{
+	if(state.intervals)
+	{
+		stb__sbn(state.intervals) = 0;
+	}
+	if(state.active)
+	{
+		stb__sbn(state.active) = 0;
+	}
+	if(*allocations)
+	{
+		stb__sbn(*allocations) = 0;
+	}
+
+	build_intervals(decl);
+
+	uint32_t held = 0;
+	uint32_t used = 0;
+	int count = sb_count(state.intervals);
+	for(int i = 0; i < count; i++)
+	{
+		interval_t* interval = &state.intervals[i];
+		var_allocation_t allocation = { VAR_STACK };
+
+		if(interval->literal_initializer && !interval->assigned)
+		{
+			allocation.location = VAR_CONSTANT;
+			allocation.value = interval->value;
+			sb_push(*allocations, allocation);
+			continue;
+		}
+
+		// Intervals which ended before this one starts give up their registers.
+		while(sb_count(state.active) > 0 && state.intervals[state.active[0]].end < interval->start)
+		{
+			held &= ~(1u << (*allocations)[state.active[0]].reg);
+			remove_active(0);
+		}
+
+		for(int r = 0; r < register_count; r++)
+		{
+			if(!(held & (1u << registers[r])))
+			{
+				allocation.location = VAR_REGISTER;
+				allocation.reg = registers[r];
+				break;
+			}
+		}
+
+		if(allocation.location != VAR_REGISTER && sb_count(state.active) > 0)
+		{
+			// Every register is held, so whichever interval ends last is spilled,
+			// which frees a register for longest.
+			int last = state.active[sb_count(state.active) - 1];
+			if(state.intervals[last].end > interval->end)
+			{
+				allocation.location = VAR_REGISTER;
+				allocation.reg = (*allocations)[last].reg;
+				(*allocations)[last].location = VAR_STACK;
+				remove_active(sb_count(state.active) - 1);
+				held &= ~(1u << allocation.reg);
+			}
+		}
+
+		sb_push(*allocations, allocation);
+		if(allocation.location == VAR_REGISTER)
+		{
+			held |= 1u << allocation.reg;
+			used |= 1u << allocation.reg;
+			insert_active(i);
+		}
+	}
+
+	for(int i = 0; i < count; i++)
+	{
+		switch((*allocations)[i].location)
+		{
+		case VAR_STACK: {
+			STAT_INC(vars_stack);
+		} break;
+		case VAR_REGISTER: {
+			STAT_INC(vars_registers);
+		} break;
+		case VAR_CONSTANT: {
+			STAT_INC(vars_constant);
+		} break;
+		}
+	}
+
+	return used;
+}
@@ -0,0 +1,47 @@
+#ifndef _REGALLOC_H
+#define _REGALLOC_H
+
+#include <stdint.h>
+
+#include "parser.h"
+#include "emitter.h"
+
+// Linear-scan register allocation of the local variables of a function.
+//
+// Functions are straight-line code, so the live range of a variable is a
+// single interval, from just after the statement which declares it to the
+// last statement which refers to it. Intervals are visited in order of
+// their start, and each is given the first register, in the order the
+// caller prefers, which no live interval holds. When every register is
+// taken, whichever of the intervals ends last lives on the stack instead.
+//
+// A variable initialized with a literal and never assigned to is a
+// constant. It is never given a register nor spilled, every use of it is
+// rematerialized as an immediate instead.
+
+typedef enum
+{
+	VAR_STACK,
+	VAR_REGISTER,
+	VAR_CONSTANT
+} var_location_t;
+
+typedef struct
+{
+	var_location_t location;
+
+	union
+	{
+		reg_t reg;     // VAR_REGISTER
+		int32_t value; // VAR_CONSTANT
+	};
+} var_allocation_t;
+
+// Allocates every variable declared by the function, choosing among the
+// given registers in order of preference. 'allocations' is a stretchy
+// buffer which is cleared and then given one entry per declaration, in the
+// order they appear.
+// Returns the set of registers used, with bit 'reg' set for each.
+uint32_t regalloc_function(decl_t* decl, const reg_t* registers, int register_count, var_allocation_t** allocations);
+
+#endif
@@ -0,0 +1,382 @@
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "server.h"
+#include "foxc.h"
+#include "str.h"
+#include "buf.h"
+
+// Program compiled once at startup, so that the names every program uses are
+// interned permanently and the allocators already have memory to hand out.
+static const char warm_up_source[] = "int main() { int x = 1; return x + 2; }";
+
+// A client which leaves its connection idle for this long, or stops reading
+// its response, is disconnected so that its worker can serve another.
+#define SERVER_IO_TIMEOUT_SECONDS 30
+
+// Reads exactly 'len' bytes from the socket.
+// Returns false if the connection was closed or failed first.
+static bool read_all(int fd, void* bytes, size_t len)
+{
+	size_t done = 0;
+	while(done < len)
+	{
+		ssize_t r = recv(fd, (char*)bytes + done, len - done, 0);
+		if(r <= 0)
+		{
+			return false;
+		}
+		done += r;
+	}
+	return true;
+}
+
+// Writes exactly 'len' bytes to the socket.
+// A peer which has gone away is an error rather than a signal.
+static bool write_all(int fd, const void* bytes, size_t len)
+{
+	size_t done = 0;
+	while(done < len)
+	{
+		ssize_t r = send(fd, (const char*)bytes + done, len - done, MSG_NOSIGNAL);
+		if(r < 0)
+		{
+			return false;
+		}
+		done += r;
+	}
+	return true;
+}
+
+// Fills in the address of the socket at the given path.
+// Returns false if the path is too long to be a socket address.
+static bool socket_address(struct sockaddr_un* addr, const char* socket_path)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+	if(strlen(socket_path) >= sizeof(addr->sun_path))
+	{
+		return false;
+	}
+	strcpy(addr->sun_path, socket_path);
+	return true;
+}
+
+// Answers requests on the given connection until the client hangs up.
+// 'source' is a stretchy buffer whose capacity is kept between requests.
+static void serve_connection(foxc_context_t* context, int fd, char** source)
+{
+	server_request_t request;
+	while(read_all(fd, &request, sizeof(request)))
+	{
+		if(request.magic != SERVER_REQUEST_MAGIC || request.length > INT_MAX)
+		{
+			return;
+		}
+
+		if(*source)
+		{
+			stb__sbn(*source) = 0;
+		}
+		char* bytes = sb_add(*source, (int)request.length);
+		if(!read_all(fd, bytes, request.length))
+		{
+			return;
+		}
+
+		foxc_result_t result;
+		if(request.flags & ~SERVER_FLAGS_ALL)
+		{
+			memset(&result, 0, sizeof(result));
+			result.diagnostic = "unsupported options";
+		}
+		else
+		{
+			foxc_options_t options = { 0 };
+			options.stream = request.flags & SERVER_FLAG_STREAM;
+			options.object = request.flags & SERVER_FLAG_OBJECT;
+			options.optimize = request.flags & SERVER_FLAG_OPTIMIZE;
+			result = foxc_compile(context, bytes, request.length, &options);
+		}
+
+		server_response_t response;
+		memset(&response, 0, sizeof(response));
+		response.ok = result.ok;
+
+		const char* body = result.ok ? result.assembly : result.diagnostic;
+		response.length = result.ok ? result.assembly_length : strlen(result.diagnostic);
+
+		// Names from this request are of no use to the next one.
+		bool sent = write_all(fd, &response, sizeof(response)) && write_all(fd, body, response.length);
+		intern_reset();
+
+		if(!sent)
+		{
+			return;
+		}
+	}
+}
+
+// Returns true if the peer of the connected socket is run by the same user.
+static bool same_user(int fd)
+{
+	struct ucred peer;
+	socklen_t len = sizeof(peer);
+	if(getsockopt(fd, SOL_SOCKET, SO_PEERCRED, &peer, &len) < 0)
+	{
+		return false;
+	}
+	return peer.uid == getuid();
+}
+
+// Removes the socket at the given path if it was left behind by a server
+// which is no longer running, so that it can be bound again.
+// Returns false, with errno set, if something else is at the path: EEXIST if
+// it is not a socket, EPERM if it belongs to another user, or EADDRINUSE if a
+// server is still listening on it.
+static bool remove_stale_socket(const struct sockaddr_un* addr, const char* socket_path)
+{
+	struct stat st;
+	if(lstat(socket_path, &st) < 0)
+	{
+		return errno == ENOENT;
+	}
+	if(!S_ISSOCK(st.st_mode))
+	{
+		errno = EEXIST;
+		return false;
+	}
+	if(st.st_uid != getuid())
+	{
+		errno = EPERM;
+		return false;
+	}
+
+	int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(probe < 0)
+	{
+		return false;
+	}
+	bool live = connect(probe, (const struct sockaddr*)addr, sizeof(*addr)) == 0;
+	int connect_error = errno;
+	close(probe);
+
+	if(live)
+	{
+		errno = EADDRINUSE;
+		return false;
+	}
+	if(connect_error != ECONNREFUSED)
+	{
+		errno = connect_error;
+		return false;
+	}
+	return unlink(socket_path) == 0 || errno == ENOENT;
+}
+
+// Accepts connections on the listening socket and serves each in turn.
+// Every worker has a context, and a pinned intern table, of its own, which
+// it keeps for every connection it serves.
+static void* server_worker(void* arg)
+{
+	int listener = (int)(intptr_t)arg;
+
+	foxc_context_t* context = foxc_create();
+	foxc_compile(context, warm_up_source, sizeof(warm_up_source) - 1, NULL);
+	intern_pin();
+
+	struct timeval timeout = { SERVER_IO_TIMEOUT_SECONDS, 0 };
+	char* source = NULL;
+	for(;;)
+	{
+		int fd = accept(listener, NULL, NULL);
+		if(fd < 0)
+		{
+			continue;
+		}
+
+		if(!same_user(fd))
+		{
+			close(fd);
+			continue;
+		}
+
+		setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+		setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+		serve_connection(context, fd, &source);
+		close(fd);
+	}
+	return NULL;
+}
+
+bool run_server(const char* socket_path, int workers)
+{
+	struct sockaddr_un addr;
+	if(!socket_address(&addr, socket_path))
+	{
+		return false;
+	}
+
+	int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listener < 0)
+	{
+		return false;
+	}
+
+	if(!remove_stale_socket(&addr, socket_path))
+	{
+		int saved_errno = errno;
+		close(listener);
+		errno = saved_errno;
+		return false;
+	}
+	if(bind(listener, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(listener, SOMAXCONN) < 0)
+	{
+		close(listener);
+		return false;
+	}
+
+	// The calling thread is one of the workers, and never returns.
+	for(int i = 1; i < workers; i++)
+	{
+		pthread_t thread;
+		if(pthread_create(&thread, NULL, server_worker, (void*)(intptr_t)listener) != 0)
+		{
+			break;
+		}
+		pthread_detach(thread);
+	}
+	server_worker((void*)(intptr_t)listener);
+	return false;
+}
+
+const char* server_default_socket()
+{
+	static char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+
+	const char* runtime_dir = getenv("XDG_RUNTIME_DIR");
+	if(runtime_dir && runtime_dir[0] == '/')
+	{
+		if(snprintf(path, sizeof(path), "%s/" SERVER_SOCKET_NAME, runtime_dir) >= (int)sizeof(path))
+		{
+			errno = ENAMETOOLONG;
+			return NULL;
+		}
+		return path;
+	}
+
+	char dir[64];
+	snprintf(dir, sizeof(dir), "/tmp/foxc-%u", (unsigned)getuid());
+	if(mkdir(dir, 0700) < 0 && errno != EEXIST)
+	{
+		return NULL;
+	}
+
+	// Whoever created the directory decides who can reach the socket in it.
+	struct stat st;
+	if(lstat(dir, &st) < 0)
+	{
+		return NULL;
+	}
+	if(!S_ISDIR(st.st_mode) || st.st_uid != getuid() || (st.st_mode & 077) != 0)
+	{
+		errno = EPERM;
+		return NULL;
+	}
+
+	snprintf(path, sizeof(path), "%s/" SERVER_SOCKET_NAME, dir);
+	return path;
+}
+
+bool server_connect(server_client_t* client, const char* socket_path)
+{
+	client->fd = -1;
+	client->body = NULL;
+
+	struct sockaddr_un addr;
+	if(!socket_address(&addr, socket_path))
+	{
+		return false;
+	}
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(fd < 0)
+	{
+		return false;
+	}
+
+	if(connect(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0)
+	{
+		int saved_errno = errno;
+		close(fd);
+		errno = saved_errno;
+		return false;
+	}
+	if(!same_user(fd))
+	{
+		close(fd);
+		errno = EPERM;
+		return false;
+	}
+
+	client->fd = fd;
+	return true;
+}
+
+bool server_compile(server_client_t* client, const char* source, uint64_t length, uint32_t flags, bool* ok)
+{
+	server_request_t request;
+	memset(&request, 0, sizeof(request));
+	request.magic = SERVER_REQUEST_MAGIC;
+	request.flags = flags;
+	request.length = length;
+
+	if(!write_all(client->fd, &request, sizeof(request)) || !write_all(client->fd, source, length))
+	{
+		return false;
+	}
+
+	server_response_t response;
+	if(!read_all(client->fd, &response, sizeof(response)) || response.length > INT_MAX)
+	{
+		return false;
+	}
+
+	if(client->body)
+	{
+		stb__sbn(client->body) = 0;
+	}
+	char* body = sb_add(client->body, (int)response.length);
+	if(!read_all(client->fd, body, response.length))
+	{
+		return false;
+	}
+
+	// Terminate the body without counting the terminator.
+	sb_push(client->body, '\0');
+	stb__sbn(client->body)--;
+
+	*ok = response.ok;
+	return true;
+}
+
+void server_disconnect(server_client_t* client)
+{
+	if(client->fd >= 0)
+	{
+		close(client->fd);
+	}
+	sb_free(client->body);
+	client->body = NULL;
+}
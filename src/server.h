@@ -0,0 +1,92 @@
+#ifndef _SERVER_H
+#define _SERVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// A compile server keeps one compiler warm between compilations, so that
+// compiling many small files does not pay for process startup, an empty
+// intern table and cold allocators every time.
+//
+// Clients connect to a Unix domain socket and send any number of requests
+// over the connection, each of which is answered before the next is read.
+// Several connections are served at once, each by one of a fixed set of
+// worker threads, and a connection which stays idle for too long is closed.
+// Every integer on the wire is in the host's byte order, as both ends are
+// always on the same machine.
+
+// Number of connections served at once when not given on the command line.
+#define SERVER_DEFAULT_WORKERS 8
+
+// Name of the socket used when none is given on the command line, in a
+// directory private to the user, see 'server_default_socket()'.
+#define SERVER_SOCKET_NAME "foxc.sock"
+
+// Identifies a request, and the version of the protocol it was sent with.
+#define SERVER_REQUEST_MAGIC 0x32435846 // "FXC2"
+
+// Request flags, mirroring 'foxc_options_t'. A request with any other flag
+// set is answered with a diagnostic.
+#define SERVER_FLAG_STREAM   (1 << 0)
+#define SERVER_FLAG_OBJECT   (1 << 1)
+#define SERVER_FLAG_OPTIMIZE (1 << 2)
+#define SERVER_FLAGS_ALL     (SERVER_FLAG_STREAM | SERVER_FLAG_OBJECT | SERVER_FLAG_OPTIMIZE)
+
+// Header of a request, followed by 'length' bytes of source.
+typedef struct
+{
+	uint32_t magic;
+	uint32_t flags;
+	uint64_t length;
+} server_request_t;
+
+// Header of a response, followed by 'length' bytes of assembly, or of an
+// object if one was asked for, if 'ok' is set, or of the diagnostic
+// otherwise.
+typedef struct
+{
+	uint32_t ok;
+	uint32_t reserved;
+	uint64_t length;
+} server_response_t;
+
+// Serves compile requests on the socket at the given path, on up to
+// 'workers' connections at once, until the process is killed. A stale socket
+// left behind by an earlier server run by the same user is replaced, but
+// nothing else at the path is: not a file of another kind, nor the socket of
+// a server which is still running. Only clients run by the same user are
+// served.
+// Returns false, with errno set, if the socket could not be set up.
+bool run_server(const char* socket_path, int workers);
+
+// Returns the path of the socket used when none is given on the command line,
+// which is '$XDG_RUNTIME_DIR/foxc.sock', or else '/tmp/foxc-<uid>/foxc.sock'.
+// The directory in /tmp is created if needed, and is only used if it belongs
+// to the user and no one else can access it, as anyone could create it first.
+// Returns NULL, with errno set, if there is no such directory.
+const char* server_default_socket();
+
+// A connection to a compile server, returned by 'server_connect()'.
+typedef struct
+{
+	int fd;
+
+	// Stretchy buffer holding the body of the last response, which is NUL
+	// terminated.
+	char* body;
+} server_client_t;
+
+// Connects to the server listening on the given socket, which must be run by
+// the same user, so that no one else can answer with code of their choosing.
+// Returns false, with errno set, if there is no such server to connect to.
+bool server_connect(server_client_t* client, const char* socket_path);
+
+// Sends 'length' bytes of source to the server and waits for the result.
+// On success 'client->body' holds the assembly if '*ok' is set, or the
+// diagnostic if it is not. Returns false if the connection failed.
+bool server_compile(server_client_t* client, const char* source, uint64_t length, uint32_t flags, bool* ok);
+
+// Closes the connection and releases the last response.
+void server_disconnect(server_client_t* client);
+
+#endif
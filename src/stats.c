@@ -0,0 +1,346 @@
+#include <string.h>
+#include <time.h>
+#include <inttypes.h>
+#include <pthread.h>
+
+#include "stats.h"
+
+_Thread_local stats_t stats;
+
+typedef struct
+{
+	phase_t phase;
+	int thread;
+	uint64_t start_ns;
+	uint64_t duration_ns;
+} trace_event_t;
+
+static _Thread_local struct
+{
+	// Id of the thread in the trace, starting from 1.
+	int thread;
+
+	// Start time of each phase which is currently running.
+	uint64_t started_ns[PHASE_COUNT];
+
+	// Every completed phase, in the order they finished.
+	trace_event_t* events;
+} state;
+
+// Statistics flushed from every thread, which are the ones reported.
+static struct
+{
+	pthread_mutex_t lock;
+
+	// Time at which statistics were first enabled, trace timestamps are
+	// relative to this.
+	uint64_t epoch_ns;
+	int thread_count;
+
+	stats_t stats;
+	trace_event_t* events;
+} totals = { .lock = PTHREAD_MUTEX_INITIALIZER };
+
+static const char* phase_names[PHASE_COUNT] =
+{
+	"lex",
+	"parse",
+	"print_ast",
+	"optimize",
+	"generate",
+	"run"
+};
+
+static const char* expr_names[] = { "literal", "unary", "binary", "assignment", "var" };
+static const char* stmt_names[] = { "expr", "return", "declare" };
+static const char* decl_names[] = { "func" };
+
+static uint64_t now_ns()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+void stats_enable()
+{
+	if(stats.enabled)
+	{
+		return;
+	}
+
+	pthread_mutex_lock(&totals.lock);
+	if(totals.thread_count == 0)
+	{
+		totals.epoch_ns = now_ns();
+	}
+	state.thread = ++totals.thread_count;
+	pthread_mutex_unlock(&totals.lock);
+
+	stats.enabled = true;
+}
+
+void stats_begin(phase_t phase)
+{
+	if(!stats.enabled)
+	{
+		return;
+	}
+	state.started_ns[phase] = now_ns();
+}
+
+void stats_end(phase_t phase)
+{
+	if(!stats.enabled)
+	{
+		return;
+	}
+
+	uint64_t end = now_ns();
+	uint64_t start = state.started_ns[phase];
+
+	stats.phase_ns[phase] += end - start;
+	stats.phase_calls[phase]++;
+
+	trace_event_t event;
+	event.phase = phase;
+	event.thread = state.thread;
+	event.start_ns = start - totals.epoch_ns;
+	event.duration_ns = end - start;
+	sb_push(state.events, event);
+}
+
+void stats_count_insn(const char* text)
+{
+	stats.insns++;
+
+	int len = strcspn(text, " \t\n");
+	if(len >= (int)sizeof(stats.mnemonics[0].name))
+	{
+		len = sizeof(stats.mnemonics[0].name) - 1;
+	}
+
+	// There are only a few dozen distinct mnemonics, so a linear scan is fine.
+	for(int i = 0; i < stats.mnemonic_count; i++)
+	{
+		mnemonic_count_t* m = &stats.mnemonics[i];
+		if(!strncmp(m->name, text, len) && m->name[len] == '\0')
+		{
+			m->count++;
+			return;
+		}
+	}
+
+	if(stats.mnemonic_count < STATS_MAX_MNEMONICS)
+	{
+		mnemonic_count_t* m = &stats.mnemonics[stats.mnemonic_count++];
+		memcpy(m->name, text, len);
+		m->name[len] = '\0';
+		m->count = 1;
+	}
+}
+
+// Adds 'count' occurrences of the named mnemonic to the given statistics.
+static void add_mnemonic(stats_t* into, const char* name, uint64_t count)
+{
+	for(int i = 0; i < into->mnemonic_count; i++)
+	{
+		if(!strcmp(into->mnemonics[i].name, name))
+		{
+			into->mnemonics[i].count += count;
+			return;
+		}
+	}
+
+	if(into->mnemonic_count < STATS_MAX_MNEMONICS)
+	{
+		mnemonic_count_t* m = &into->mnemonics[into->mnemonic_count++];
+		strcpy(m->name, name);
+		m->count = count;
+	}
+}
+
+void stats_flush()
+{
+	pthread_mutex_lock(&totals.lock);
+
+	stats_t* t = &totals.stats;
+	for(int i = 0; i < PHASE_COUNT; i++)
+	{
+		t->phase_ns[i] += stats.phase_ns[i];
+		t->phase_calls[i] += stats.phase_calls[i];
+	}
+
+	t->tokens += stats.tokens;
+	for(int i = 0; i <= EXPR_VAR; i++)
+	{
+		t->exprs[i] += stats.exprs[i];
+	}
+	for(int i = 0; i <= STMT_DECLARE; i++)
+	{
+		t->stmts[i] += stats.stmts[i];
+	}
+	for(int i = 0; i <= DECL_FUNC; i++)
+	{
+		t->decls[i] += stats.decls[i];
+	}
+
+	t->intern_hits += stats.intern_hits;
+	t->intern_misses += stats.intern_misses;
+	t->cache_hits += stats.cache_hits;
+	t->cache_misses += stats.cache_misses;
+	t->folds += stats.folds;
+	t->simplifications += stats.simplifications;
+	t->spills += stats.spills;
+	t->vars_registers += stats.vars_registers;
+	t->vars_stack += stats.vars_stack;
+	t->vars_constant += stats.vars_constant;
+	t->labels += stats.labels;
+	t->short_jumps += stats.short_jumps;
+	t->near_jumps += stats.near_jumps;
+	t->promotions += stats.promotions;
+	t->vm_insns += stats.vm_insns;
+	t->vm_fused += stats.vm_fused;
+	t->insns += stats.insns;
+	for(int i = 0; i < stats.mnemonic_count; i++)
+	{
+		add_mnemonic(t, stats.mnemonics[i].name, stats.mnemonics[i].count);
+	}
+
+	for(int i = 0; i < sb_count(state.events); i++)
+	{
+		sb_push(totals.events, state.events[i]);
+	}
+
+	pthread_mutex_unlock(&totals.lock);
+
+	// Start afresh, so that flushing again does not count anything twice.
+	bool enabled = stats.enabled;
+	memset(&stats, 0, sizeof(stats));
+	stats.enabled = enabled;
+
+	sb_free(state.events);
+	state.events = NULL;
+}
+
+static int compare_mnemonics(const void* a, const void* b)
+{
+	const mnemonic_count_t* ma = a;
+	const mnemonic_count_t* mb = b;
+	if(ma->count != mb->count)
+	{
+		return ma->count < mb->count ? 1 : -1;
+	}
+	return strcmp(ma->name, mb->name);
+}
+
+typedef void (*counter_visitor_t)(FILE* handle, const char* name, uint64_t value, uint64_t ts_ns);
+
+// Calls 'visit' once for each counter, with its fully qualified name.
+static void visit_counters(counter_visitor_t visit, FILE* handle, uint64_t ts_ns)
+{
+	char name[64];
+
+	visit(handle, "tokens", totals.stats.tokens, ts_ns);
+	for(int i = 0; i <= EXPR_VAR; i++)
+	{
+		snprintf(name, sizeof(name), "expr.%s", expr_names[i]);
+		visit(handle, name, totals.stats.exprs[i], ts_ns);
+	}
+	for(int i = 0; i <= STMT_DECLARE; i++)
+	{
+		snprintf(name, sizeof(name), "stmt.%s", stmt_names[i]);
+		visit(handle, name, totals.stats.stmts[i], ts_ns);
+	}
+	for(int i = 0; i <= DECL_FUNC; i++)
+	{
+		snprintf(name, sizeof(name), "decl.%s", decl_names[i]);
+		visit(handle, name, totals.stats.decls[i], ts_ns);
+	}
+	visit(handle, "intern.hits", totals.stats.intern_hits, ts_ns);
+	visit(handle, "intern.misses", totals.stats.intern_misses, ts_ns);
+	visit(handle, "cache.hits", totals.stats.cache_hits, ts_ns);
+	visit(handle, "cache.misses", totals.stats.cache_misses, ts_ns);
+	visit(handle, "fold.exprs", totals.stats.folds, ts_ns);
+	visit(handle, "fold.simplified", totals.stats.simplifications, ts_ns);
+	visit(handle, "regs.spills", totals.stats.spills, ts_ns);
+	visit(handle, "vars.registers", totals.stats.vars_registers, ts_ns);
+	visit(handle, "vars.stack", totals.stats.vars_stack, ts_ns);
+	visit(handle, "vars.constant", totals.stats.vars_constant, ts_ns);
+	visit(handle, "labels", totals.stats.labels, ts_ns);
+	visit(handle, "jumps.short", totals.stats.short_jumps, ts_ns);
+	visit(handle, "jumps.near", totals.stats.near_jumps, ts_ns);
+	visit(handle, "tier.promotions", totals.stats.promotions, ts_ns);
+	visit(handle, "vm.insns", totals.stats.vm_insns, ts_ns);
+	visit(handle, "vm.fused", totals.stats.vm_fused, ts_ns);
+	visit(handle, "insns", totals.stats.insns, ts_ns);
+
+	// Most frequently emitted instructions first.
+	qsort(totals.stats.mnemonics, totals.stats.mnemonic_count, sizeof(mnemonic_count_t), compare_mnemonics);
+	for(int i = 0; i < totals.stats.mnemonic_count; i++)
+	{
+		snprintf(name, sizeof(name), "insn.%s", totals.stats.mnemonics[i].name);
+		visit(handle, name, totals.stats.mnemonics[i].count, ts_ns);
+	}
+}
+
+static void print_counter(FILE* handle, const char* name, uint64_t value, uint64_t ts_ns)
+{
+	fprintf(handle, "%-24s %12" PRIu64 "\n", name, value);
+}
+
+// Writes a single counter event holding the given value.
+static void write_counter(FILE* handle, const char* name, uint64_t value, uint64_t ts_ns)
+{
+	fprintf(handle, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":1,\"tid\":1,\"args\":{\"value\":%" PRIu64 "}}",
+		name, ts_ns / 1e3, value);
+}
+
+void stats_print(FILE* handle, bool counters)
+{
+	uint64_t total_ns = 0;
+	for(int i = 0; i < PHASE_COUNT; i++)
+	{
+		total_ns += totals.stats.phase_ns[i];
+	}
+
+	fprintf(handle, "phase          calls      time (ms)      %%\n");
+	for(int i = 0; i < PHASE_COUNT; i++)
+	{
+		double percent = total_ns ? 100.0 * totals.stats.phase_ns[i] / total_ns : 0.0;
+		fprintf(handle, "%-12s %7" PRIu64 " %14.3f %6.1f\n",
+			phase_names[i], totals.stats.phase_calls[i], totals.stats.phase_ns[i] / 1e6, percent);
+	}
+	fprintf(handle, "%-12s %7s %14.3f\n", "total", "", total_ns / 1e6);
+
+	if(counters)
+	{
+		fprintf(handle, "\ncounter                         value\n");
+		visit_counters(print_counter, handle, 0);
+	}
+}
+
+void stats_write_trace(FILE* handle)
+{
+	fprintf(handle, "{\"traceEvents\":[\n");
+	fprintf(handle, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"foxc\"}}");
+
+	// Complete events, timestamps are in microseconds.
+	uint64_t last_ns = 0;
+	for(int i = 0; i < sb_count(totals.events); i++)
+	{
+		trace_event_t* e = &totals.events[i];
+		fprintf(handle, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}",
+			phase_names[e->phase], e->start_ns / 1e3, e->duration_ns / 1e3, e->thread);
+
+		if(e->start_ns + e->duration_ns > last_ns)
+		{
+			last_ns = e->start_ns + e->duration_ns;
+		}
+	}
+
+	// Counters are recorded once, at the end of the trace.
+	visit_counters(write_counter, handle, last_ns);
+
+	fprintf(handle, "\n]}\n");
+}
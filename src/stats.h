@@ -0,0 +1,102 @@
+#ifndef _STATS_H
+#define _STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "parser.h"
+
+// Compiler phases which are timed.
+typedef enum
+{
+	PHASE_LEX,
+	PHASE_PARSE,
+	PHASE_PRINT_AST,
+	PHASE_OPTIMIZE,
+	PHASE_GENERATE,
+	PHASE_RUN,
+	PHASE_COUNT
+} phase_t;
+
+// Maximum number of distinct instruction mnemonics which are counted.
+#define STATS_MAX_MNEMONICS 64
+
+typedef struct
+{
+	char name[16];
+	uint64_t count;
+} mnemonic_count_t;
+
+// Instrumentation collected by a thread since it last called 'stats_flush()'.
+// Plain counters are always updated, as an increment is cheaper than testing
+// whether they are wanted. Anything which costs more than that, such as
+// reading the clock or counting mnemonics, is only done when 'enabled' is set.
+typedef struct
+{
+	bool enabled;
+
+	// Total time spent in each phase and the number of times it was entered.
+	uint64_t phase_ns[PHASE_COUNT];
+	uint64_t phase_calls[PHASE_COUNT];
+
+	uint64_t tokens;
+	uint64_t exprs[EXPR_VAR + 1];
+	uint64_t stmts[STMT_DECLARE + 1];
+	uint64_t decls[DECL_FUNC + 1];
+
+	uint64_t intern_hits;
+	uint64_t intern_misses;
+
+	uint64_t cache_hits;
+	uint64_t cache_misses;
+
+	uint64_t folds;
+	uint64_t simplifications;
+
+	uint64_t spills;
+	uint64_t vars_registers;
+	uint64_t vars_stack;
+	uint64_t vars_constant;
+	uint64_t labels;
+	uint64_t short_jumps;
+	uint64_t near_jumps;
+	uint64_t promotions;
+	uint64_t vm_insns;
+	uint64_t vm_fused;
+	uint64_t insns;
+	mnemonic_count_t mnemonics[STATS_MAX_MNEMONICS];
+	int mnemonic_count;
+} stats_t;
+
+extern _Thread_local stats_t stats;
+
+// Bumps a counter in the calling thread's statistics.
+#define STAT_INC(field) (stats.field++)
+
+// Starts collecting timings and detailed counters on the calling thread.
+void stats_enable();
+
+// Adds the calling thread's statistics to the totals for the process, and
+// clears them. Only flushed statistics are reported.
+void stats_flush();
+
+// Marks the start of a phase, must be paired with 'stats_end()'.
+void stats_begin(phase_t phase);
+
+// Marks the end of the phase most recently started with 'stats_begin()'.
+void stats_end(phase_t phase);
+
+// Counts an emitted instruction, given its text starting with the mnemonic.
+void stats_count_insn(const char* text);
+
+// Prints the flushed statistics as a human readable table. Phase times are
+// summed over every thread.
+// If 'counters' is false, only the phase timings are printed.
+void stats_print(FILE* handle, bool counters);
+
+// Writes the flushed statistics in the Chrome trace event format, which can
+// be loaded by chrome://tracing or Perfetto.
+void stats_write_trace(FILE* handle);
+
+#endif
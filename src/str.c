@@ -1,34 +1,184 @@
+#include <stdint.h>
+
 #include "str.h"
+#include "arena.h"
+#include "error.h"
+#include "stats.h"
+
+// Initial number of slots in the intern table, must be a power of two.
+#define INTERN_TABLE_MIN_CAPACITY 1024
+
+typedef struct
+{
+	uint32_t hash;
+	uint32_t len;
+	str_t str;
+} intern_entry_t;
+
+// The intern table is an open-addressing hash table using linear probing.
+// String bytes are packed into an arena which lives for the lifetime of the
+// program, so interned pointers remain valid forever.
+// Each thread has its own table, so strings interned by different threads
+// must not be compared by pointer.
+// Once the table has been pinned, new strings are packed into a separate
+// arena instead, and 'intern_reset()' restores the table from a snapshot
+// taken by 'intern_pin()'.
+static _Thread_local struct
+{
+	intern_entry_t* entries;
+	uint32_t capacity;
+	uint32_t count;
+
+	arena_t arena;
+
+	// Copy of the table as of the last 'intern_pin()', or NULL if it has
+	// never been pinned.
+	intern_entry_t* pinned;
+	uint32_t pinned_capacity;
+	uint32_t pinned_count;
+
+	arena_t transient;
+} state;
+
+// 32-bit FNV-1a.
+static uint32_t hash_range(const char* buf, int len)
+{
+	uint32_t hash = 2166136261u;
+	for(int i = 0; i < len; i++)
+	{
+		hash ^= (unsigned char)buf[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+// Doubles the size of the table, re-inserting all existing entries.
+static void grow_table()
+{
+	uint32_t new_capacity = state.capacity ? state.capacity * 2 : INTERN_TABLE_MIN_CAPACITY;
+	intern_entry_t* new_entries = calloc(new_capacity, sizeof(intern_entry_t));
+	if(new_entries == NULL)
+	{
+		error("out of memory\n");
+	}
+
+	uint32_t mask = new_capacity - 1;
+	for(uint32_t i = 0; i < state.capacity; i++)
+	{
+		intern_entry_t entry = state.entries[i];
+		if(entry.str == NULL)
+		{
+			continue;
+		}
+
+		uint32_t slot = entry.hash & mask;
+		while(new_entries[slot].str)
+		{
+			slot = (slot + 1) & mask;
+		}
+		new_entries[slot] = entry;
+	}
+
+	free(state.entries);
+	state.entries = new_entries;
+	state.capacity = new_capacity;
+}
 
-static str_t* intern_table = NULL;
+str_t intern_str(const char* str)
+{
+	return intern_str_range(str, strlen(str));
+}
 
-str_t intern_str(char* str)
+str_t intern_str_range(const char* buf, int len)
 {
+	// Keep the load factor at or below one half.
+	if((state.count + 1) * 2 > state.capacity)
+	{
+		grow_table();
+	}
+
+	uint32_t hash = hash_range(buf, len);
+	uint32_t mask = state.capacity - 1;
+	uint32_t slot = hash & mask;
+
 	// Try and find the string in the intern table.
-	for(int i = 0; i < sb_count(intern_table); i++)
+	while(state.entries[slot].str)
 	{
-		// We must use strcmp here as we cannot be sure that the input
-		// string is a valid interned string.
-		if(!strcmp(intern_table[i], str))
+		intern_entry_t* entry = &state.entries[slot];
+		if(entry->hash == hash && entry->len == (uint32_t)len && !memcmp(entry->str, buf, len))
 		{
-			return intern_table[i];
+			STAT_INC(intern_hits);
+			return entry->str;
 		}
+		slot = (slot + 1) & mask;
+	}
+
+	// If we don't have the string in memory, copy it into the arena and
+	// claim the empty slot we stopped on.
+	char* s = arena_alloc_bytes(state.pinned ? &state.transient : &state.arena, len + 1);
+	memcpy(s, buf, len);
+	s[len] = '\0';
+
+	state.entries[slot].hash = hash;
+	state.entries[slot].len = len;
+	state.entries[slot].str = s;
+	state.count++;
+	STAT_INC(intern_misses);
+
+	return s;
+}
+
+void intern_pin()
+{
+	if(state.capacity == 0)
+	{
+		grow_table();
 	}
 
-	// If we don't have the string in memory, allocate it.
-	char* s = malloc(strlen(str) + 1);
-	memcpy(s, str, strlen(str) + 1);
-	sb_push(intern_table, s);
+	// Anything interned since an earlier pin becomes permanent too.
+	if(state.transient.head)
+	{
+		arena_block_t* block = state.transient.head;
+		while(block->next)
+		{
+			block = block->next;
+		}
+		block->next = state.arena.head;
+		state.arena.head = state.transient.head;
+		state.transient.head = NULL;
+	}
 
-	// Lazily call the function again to find the string.
-	return intern_str(s);
+	free(state.pinned);
+	state.pinned = malloc(state.capacity * sizeof(intern_entry_t));
+	if(state.pinned == NULL)
+	{
+		error("out of memory\n");
+	}
+	memcpy(state.pinned, state.entries, state.capacity * sizeof(intern_entry_t));
+	state.pinned_capacity = state.capacity;
+	state.pinned_count = state.count;
 }
 
-str_t intern_str_range(char* buf, int len)
+void intern_reset()
 {
-	// TODO: This isn't a very nice solution.
-	static char temp[1024 * 4];
-	strncpy(temp, buf, len);
-	temp[len] = '\0';
-	return intern_str(temp);
+	if(state.pinned == NULL || state.count == state.pinned_count)
+	{
+		return;
+	}
+
+	// The table may have grown since it was pinned.
+	if(state.capacity != state.pinned_capacity)
+	{
+		free(state.entries);
+		state.entries = malloc(state.pinned_capacity * sizeof(intern_entry_t));
+		if(state.entries == NULL)
+		{
+			error("out of memory\n");
+		}
+		state.capacity = state.pinned_capacity;
+	}
+
+	memcpy(state.entries, state.pinned, state.capacity * sizeof(intern_entry_t));
+	state.count = state.pinned_count;
+	arena_reset(&state.transient);
 }
@@ -15,10 +15,18 @@ typedef char* str_t;
 
 // Look up or insert the given string into the intern table.
 // The returned pointer will be a valid entry into the intern table.
-str_t intern_str(char* str);
+str_t intern_str(const char* str);
 
 // Look up or insert the given string range into the intern table.
 // The returned pointer will be a valid entry into the intern table.
-str_t intern_str_range(char* buf, int len);
+str_t intern_str_range(const char* buf, int len);
+
+// Marks every string interned so far on the calling thread as permanent.
+// Strings interned afterwards only live until the next 'intern_reset()'.
+void intern_pin();
+
+// Removes every string interned since the last 'intern_pin()' from the
+// calling thread's table. Pointers to those strings become invalid.
+void intern_reset();
 
 #endif
@@ -0,0 +1,320 @@
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "tier.h"
+#include "generator.h"
+#include "object.h"
+#include "jit.h"
+#include "stats.h"
+
+// Size of an entry stub, 'jmp *slot(%rip)' padded with 'int3'.
+#define STUB_SIZE 8
+
+// Size of the code which calls 'promote()', which the counter skips over.
+#define PROMOTE_SIZE 37
+
+typedef struct
+{
+	decl_t* decl;
+	int tier;
+} tier_function_t;
+
+struct tier_engine
+{
+	program_t* program;
+	uint32_t threshold;
+
+	// A single mapping holding the entry stubs, followed on their own pages
+	// by the pointers the stubs jump through and the call counters. Keeping
+	// them together means the stubs can reach the pointers RIP-relative.
+	char* memory;
+	size_t memory_size;
+	size_t stubs_size;
+	_Atomic(void*)* slots;
+	uint32_t* counters;
+
+	tier_function_t* functions;
+	int function_count;
+
+	// The unoptimized code of every function, and the optimized code of each
+	// function which has been promoted.
+	jit_image_t baseline;
+	jit_image_t* optimized;
+
+	// Held while a function is promoted.
+	pthread_mutex_t lock;
+};
+
+static _Thread_local struct
+{
+	// The engine whose baseline code is being generated, and the index of the
+	// function being generated.
+	tier_engine_t* engine;
+	uint32_t index;
+} state;
+
+static void code_imm64(uint64_t value)
+{
+	object_bytes(&value, sizeof(value));
+}
+
+// Recompiles a function with optimization on the calling thread, returning
+// the address of its code or NULL if it could not be loaded.
+static void* compile_optimized(tier_engine_t* engine, decl_t* decl)
+{
+	target_t target = insn_target();
+	bool optimize = generate_optimize();
+
+	object_begin();
+	insn_set_target(TARGET_OBJECT);
+	generate_set_optimize(true);
+
+	generate_begin();
+	generate_declaration(decl);
+	generate_end();
+
+	insn_set_target(target);
+	generate_set_optimize(optimize);
+
+	jit_image_t image;
+	if(!jit_load(&image))
+	{
+		return NULL;
+	}
+	sb_push(engine->optimized, image);
+	return jit_lookup(&sb_last(engine->optimized), decl->name);
+}
+
+// Called by the unoptimized code of a function when its counter reaches the
+// threshold. Optimizes the function and points its stub at the new code,
+// returning the address the call should continue at.
+static void* promote(tier_engine_t* engine, uint32_t index)
+{
+	pthread_mutex_lock(&engine->lock);
+
+	tier_function_t* function = &engine->functions[index];
+	if(function->tier == 0)
+	{
+		void* code = compile_optimized(engine, function->decl);
+		if(code)
+		{
+			atomic_store_explicit(&engine->slots[index], code, memory_order_release);
+			function->tier = 1;
+			STAT_INC(promotions);
+		}
+	}
+
+	// If the function could not be optimized, the stub still points at the
+	// unoptimized code, whose counter is now past the threshold.
+	void* target = atomic_load_explicit(&engine->slots[index], memory_order_acquire);
+	pthread_mutex_unlock(&engine->lock);
+	return target;
+}
+
+// Entry hook adding the call counter to the unoptimized code of a function.
+// Only the caller-saved %eax, %r11, and when promoting the argument
+// registers, are used, and the functions take no arguments.
+static void emit_counter(decl_t* decl)
+{
+	tier_engine_t* engine = state.engine;
+	uint32_t index = state.index++;
+
+	// movl $1, %eax
+	object_byte(0xb8);
+	object_imm32(1);
+	// movabs $counter, %r11
+	object_bytes("\x49\xbb", 2);
+	code_imm64((uintptr_t)&engine->counters[index]);
+	// lock xaddl %eax, (%r11)
+	object_bytes("\xf0\x41\x0f\xc1\x03", 5);
+	// Exactly one call sees the count just below the threshold.
+	// cmpl $threshold - 1, %eax
+	object_byte(0x3d);
+	object_imm32(engine->threshold - 1);
+	// jne past the promotion
+	object_byte(0x75);
+	object_byte(PROMOTE_SIZE);
+
+	// The return address is still on top of the stack, so once 'promote()'
+	// returns, jumping to the optimized code completes the original call.
+	// movabs $engine, %rdi
+	object_bytes("\x48\xbf", 2);
+	code_imm64((uintptr_t)engine);
+	// movl $index, %esi
+	object_byte(0xbe);
+	object_imm32(index);
+	// movabs $promote, %rax
+	object_bytes("\x48\xb8", 2);
+	code_imm64((uintptr_t)promote);
+	// subq $8, %rsp, aligning the stack for the call
+	object_bytes("\x48\x83\xec\x08", 4);
+	// call *%rax
+	object_bytes("\xff\xd0", 2);
+	// addq $8, %rsp
+	object_bytes("\x48\x83\xc4\x08", 4);
+	// jmp *%rax
+	object_bytes("\xff\xe0", 2);
+}
+
+// Generates and loads the unoptimized code of every function.
+static bool compile_baseline(tier_engine_t* engine)
+{
+	target_t target = insn_target();
+	bool optimize = generate_optimize();
+
+	object_begin();
+	insn_set_target(TARGET_OBJECT);
+	generate_set_optimize(false);
+	generate_set_entry_hook(emit_counter);
+	state.engine = engine;
+	state.index = 0;
+
+	generate_begin();
+	for(int i = 0; i < engine->function_count; i++)
+	{
+		generate_declaration(engine->functions[i].decl);
+	}
+	generate_end();
+
+	generate_set_entry_hook(NULL);
+	insn_set_target(target);
+	generate_set_optimize(optimize);
+	state.engine = NULL;
+
+	return jit_load(&engine->baseline);
+}
+
+// Returns the index of the named function, or -1.
+static int find_function(tier_engine_t* engine, const char* name)
+{
+	for(int i = 0; i < engine->function_count; i++)
+	{
+		if(!strcmp(engine->functions[i].decl->name, name))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+tier_engine_t* tier_create(program_t* program, uint32_t threshold)
+{
+	tier_engine_t* engine = calloc(1, sizeof(tier_engine_t));
+	engine->program = program;
+	engine->threshold = threshold;
+	pthread_mutex_init(&engine->lock, NULL);
+
+	for(int i = 0; i < program->decl_count; i++)
+	{
+		if(program->decls[i]->type == DECL_FUNC)
+		{
+			tier_function_t function = { program->decls[i], 0 };
+			sb_push(engine->functions, function);
+		}
+	}
+	engine->function_count = sb_count(engine->functions);
+
+	size_t page = sysconf(_SC_PAGESIZE);
+	size_t n = engine->function_count;
+	size_t data_size = n * (sizeof(void*) + sizeof(uint32_t));
+	engine->stubs_size = (n * STUB_SIZE + page - 1) & ~(page - 1);
+	engine->memory_size = engine->stubs_size + ((data_size + page - 1) & ~(page - 1));
+
+	// There is always at least a page, even for an empty program.
+	if(engine->memory_size == 0)
+	{
+		engine->memory_size = page;
+	}
+
+	void* memory = mmap(NULL, engine->memory_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if(memory == MAP_FAILED)
+	{
+		tier_destroy(engine);
+		return NULL;
+	}
+	engine->memory = memory;
+	engine->slots = (_Atomic(void*)*)(engine->memory + engine->stubs_size);
+	engine->counters = (uint32_t*)(engine->slots + n);
+
+	if(!compile_baseline(engine))
+	{
+		tier_destroy(engine);
+		return NULL;
+	}
+
+	for(size_t i = 0; i < n; i++)
+	{
+		char* stub = engine->memory + i * STUB_SIZE;
+		int32_t displacement = (char*)&engine->slots[i] - (stub + 6);
+
+		// jmp *slot(%rip)
+		stub[0] = 0xff;
+		stub[1] = 0x25;
+		memcpy(stub + 2, &displacement, sizeof(displacement));
+		stub[6] = 0xcc;
+		stub[7] = 0xcc;
+
+		atomic_init(&engine->slots[i], jit_lookup(&engine->baseline, engine->functions[i].decl->name));
+	}
+
+	// The stubs are never written again, only the slots they jump through.
+	if(engine->stubs_size > 0)
+	{
+		if(mprotect(engine->memory, engine->stubs_size, PROT_READ | PROT_EXEC) < 0)
+		{
+			tier_destroy(engine);
+			return NULL;
+		}
+		__builtin___clear_cache(engine->memory, engine->memory + engine->stubs_size);
+	}
+
+	return engine;
+}
+
+void* tier_lookup(tier_engine_t* engine, const char* name)
+{
+	int i = find_function(engine, name);
+	return i < 0 ? NULL : engine->memory + i * STUB_SIZE;
+}
+
+int tier_level(tier_engine_t* engine, const char* name)
+{
+	int i = find_function(engine, name);
+	if(i < 0)
+	{
+		return -1;
+	}
+
+	pthread_mutex_lock(&engine->lock);
+	int tier = engine->functions[i].tier;
+	pthread_mutex_unlock(&engine->lock);
+	return tier;
+}
+
+void tier_destroy(tier_engine_t* engine)
+{
+	if(engine == NULL)
+	{
+		return;
+	}
+
+	jit_unload(&engine->baseline);
+	for(int i = 0; i < sb_count(engine->optimized); i++)
+	{
+		jit_unload(&engine->optimized[i]);
+	}
+	sb_free(engine->optimized);
+
+	if(engine->memory)
+	{
+		munmap(engine->memory, engine->memory_size);
+	}
+
+	sb_free(engine->functions);
+	pthread_mutex_destroy(&engine->lock);
+	free(engine);
+}
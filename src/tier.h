@@ -0,0 +1,50 @@
+#ifndef _TIER_H
+#define _TIER_H
+
+#include <stdint.h>
+
+#include "parser.h"
+
+// Tiered execution of a program loaded into memory.
+//
+// Every function is first compiled quickly without optimization, with a
+// counter of its calls added to its entry. Once a function has been called
+// 'threshold' times it is recompiled with optimization, and calls made from
+// then on run the optimized code.
+//
+// Functions are always called through an entry stub, which jumps through a
+// pointer to the function's current code. Replacing the pointer is a single
+// atomic store, so the stub can be called from any number of threads while
+// a function is promoted, and calls already running the old code finish
+// there. Old code is only unmapped when the engine is destroyed.
+//
+// A function is recompiled on the thread which called it, using that
+// thread's compiler state. Any object it was building is discarded, so
+// functions must not be called while the thread is compiling.
+
+// Number of calls after which a function is optimized, unless the engine is
+// given another.
+#define TIER_DEFAULT_THRESHOLD 1000
+
+typedef struct tier_engine tier_engine_t;
+
+// Compiles every function of the program and loads them into memory. The
+// program must stay alive until the engine is destroyed, as functions are
+// recompiled from it. 'threshold' must be at least one.
+// Returns NULL if the memory could not be mapped.
+tier_engine_t* tier_create(program_t* program, uint32_t threshold);
+
+// Returns the address of the entry stub of the named function, which stays
+// valid until the engine is destroyed, or NULL if the program does not
+// define it.
+void* tier_lookup(tier_engine_t* engine, const char* name);
+
+// Returns the tier the named function currently runs at, 0 for the
+// unoptimized code and 1 once it has been optimized, or -1 if the program
+// does not define it.
+int tier_level(tier_engine_t* engine, const char* name);
+
+// Unmaps all of the engine's code, every address it returned becomes invalid.
+void tier_destroy(tier_engine_t* engine);
+
+#endif
@@ -0,0 +1,648 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "vm.h"
+#include "stats.h"
+
+// Registers are numbered with 16 bits.
+#define VM_MAX_REGISTERS 65536
+
+// Functions using up to this many registers keep them on the native stack.
+#define VM_STACK_REGISTERS 256
+
+typedef enum
+{
+	OP_LOADI,  // a = imm
+	OP_MOV,    // a = b
+	OP_ADD,    // a = b op c
+	OP_SUB,
+	OP_MUL,
+	OP_DIV,
+	OP_MOD,
+	OP_AND,
+	OP_OR,
+	OP_XOR,
+	OP_SHL,
+	OP_SHR,
+	OP_LT,     // a = b cmp c
+	OP_LE,
+	OP_GT,
+	OP_GE,
+	OP_EQ,
+	OP_NE,
+	OP_NEG,    // a = op b
+	OP_NOT,
+	OP_LNOT,
+	OP_JMP,    // jump by imm
+	OP_JZ,     // jump by imm if a is zero
+	OP_JNZ,    // jump by imm if a is not zero
+	OP_RET,    // return a
+
+	// Superinstructions.
+	OP_ADDI,   // a = b + (int16_t)c
+	OP_JLT,    // jump by (int16_t)c if a cmp b
+	OP_JLE,
+	OP_JGT,
+	OP_JGE,
+	OP_JEQ,
+	OP_JNE,
+
+	OP_COUNT
+} opcode_t;
+
+typedef struct
+{
+	uint8_t op;
+	uint8_t unused;
+	uint16_t a;
+	union
+	{
+		struct
+		{
+			uint16_t b;
+			uint16_t c;
+		};
+		int32_t imm;
+	};
+} vm_insn_t;
+
+typedef struct
+{
+	const char* name;
+	uint32_t offset;
+	uint32_t register_count;
+} vm_function_t;
+
+struct vm_program
+{
+	vm_insn_t* code;
+	vm_function_t* functions;
+};
+
+typedef struct
+{
+	str_t name;
+	int reg;
+} vm_var_t;
+
+// State for the compiler, each thread has its own.
+static _Thread_local struct
+{
+	vm_program_t* program;
+
+	vm_var_t* vars;
+
+	// Registers below 'locals' hold variables, temporaries are allocated
+	// upwards from there and released at the end of each statement.
+	int locals;
+	int temps;
+	int register_count;
+
+	// Compare and branch superinstructions only reach 16-bit offsets. If a
+	// function turns out to need more, it is compiled again without them.
+	bool fuse_branches;
+	bool out_of_range;
+} state;
+
+// Binary operations, and the branch which tests each comparison.
+static const uint8_t binary_ops[] =
+{
+	[BINARY_ADD]         = OP_ADD,
+	[BINARY_SUB]         = OP_SUB,
+	[BINARY_MUL]         = OP_MUL,
+	[BINARY_DIV]         = OP_DIV,
+	[BINARY_MODULO]      = OP_MOD,
+	[BINARY_BITWISE_AND] = OP_AND,
+	[BINARY_BITWISE_OR]  = OP_OR,
+	[BINARY_BITWISE_XOR] = OP_XOR,
+	[BINARY_SHIFT_LEFT]  = OP_SHL,
+	[BINARY_SHIFT_RIGHT] = OP_SHR,
+	[BINARY_LESS]        = OP_LT,
+	[BINARY_LESS_EQ]     = OP_LE,
+	[BINARY_GRTR]        = OP_GT,
+	[BINARY_GRTR_EQ]     = OP_GE,
+	[BINARY_EQUALS]      = OP_EQ,
+	[BINARY_NOT_EQ]      = OP_NE
+};
+
+static const uint8_t branch_ops[] =
+{
+	[OP_LT] = OP_JLT,
+	[OP_LE] = OP_JLE,
+	[OP_GT] = OP_JGT,
+	[OP_GE] = OP_JGE,
+	[OP_EQ] = OP_JEQ,
+	[OP_NE] = OP_JNE
+};
+
+// The comparison which holds exactly when the given one does not.
+static const uint8_t inverse_ops[] =
+{
+	[OP_LT] = OP_GE,
+	[OP_LE] = OP_GT,
+	[OP_GT] = OP_LE,
+	[OP_GE] = OP_LT,
+	[OP_EQ] = OP_NE,
+	[OP_NE] = OP_EQ
+};
+
+//
+// Compiler.
+//
+
+// Appends an instruction, returning its index.
+static int emit(uint8_t op, int a, int b, int c)
+{
+	STAT_INC(vm_insns);
+
+	vm_insn_t insn;
+	memset(&insn, 0, sizeof(insn));
+	insn.op = op;
+	insn.a = a;
+	insn.b = b;
+	insn.c = c;
+	sb_push(state.program->code, insn);
+	return sb_count(state.program->code) - 1;
+}
+
+static int emit_imm(uint8_t op, int a, int32_t imm)
+{
+	int at = emit(op, a, 0, 0);
+	state.program->code[at].imm = imm;
+	return at;
+}
+
+// Points the jump at the given index to the next instruction.
+static void patch(int at)
+{
+	vm_insn_t* insn = &state.program->code[at];
+	int32_t offset = sb_count(state.program->code) - at;
+
+	if(insn->op >= OP_JLT)
+	{
+		if(offset > INT16_MAX)
+		{
+			state.out_of_range = true;
+		}
+		insn->c = (uint16_t)offset;
+	}
+	else
+	{
+		insn->imm = offset;
+	}
+}
+
+static void use_registers(int count)
+{
+	if(count > VM_MAX_REGISTERS)
+	{
+		error("function needs more than %d registers\n", VM_MAX_REGISTERS);
+	}
+	if(count > state.register_count)
+	{
+		state.register_count = count;
+	}
+}
+
+static int alloc_temp()
+{
+	use_registers(state.temps + 1);
+	return state.temps++;
+}
+
+// Returns the register a result is to be left in, 'dst' if one was asked for
+// and a new temporary otherwise.
+static int result_reg(int dst)
+{
+	return dst >= 0 ? dst : alloc_temp();
+}
+
+static int var_reg(str_t name)
+{
+	for(int i = 0; i < sb_count(state.vars); i++)
+	{
+		if(state.vars[i].name == name)
+		{
+			return state.vars[i].reg;
+		}
+	}
+	error("'%s' undeclared\n", name);
+}
+
+// Returns true if the expression is a literal which fits in a 16-bit
+// immediate once negated, if 'negate' is set.
+static bool is_small_literal(expr_t* expr, bool negate)
+{
+	if(expr->type != EXPR_LITERAL)
+	{
+		return false;
+	}
+	int64_t value = (int32_t)expr->value;
+	if(negate)
+	{
+		value = -value;
+	}
+	return value >= INT16_MIN && value <= INT16_MAX;
+}
+
+static bool is_comparison(expr_t* expr)
+{
+	return expr->type == EXPR_BINARY
+		&& expr->binary_operator >= BINARY_LESS
+		&& expr->binary_operator <= BINARY_NOT_EQ;
+}
+
+static int compile_expr(expr_t* expr, int dst);
+
+// Compiles a jump which is taken when the truth of the expression is 'when',
+// returning its index to be patched.
+static int compile_branch(expr_t* expr, bool when)
+{
+	int top = state.temps;
+
+	if(state.fuse_branches && is_comparison(expr))
+	{
+		STAT_INC(vm_fused);
+		int lhs = compile_expr(expr->binary_lhs, -1);
+		int rhs = compile_expr(expr->binary_rhs, -1);
+		state.temps = top;
+
+		uint8_t op = binary_ops[expr->binary_operator];
+		if(!when)
+		{
+			op = inverse_ops[op];
+		}
+		return emit(branch_ops[op], lhs, rhs, 0);
+	}
+
+	int value = compile_expr(expr, -1);
+	state.temps = top;
+	return emit_imm(when ? OP_JNZ : OP_JZ, value, 0);
+}
+
+// Compiles '&&' and '||'. The result is 1 if the operands are all true, or
+// any true, respectively.
+static int compile_logical(expr_t* expr, int dst)
+{
+	bool is_or = expr->binary_operator == BINARY_LOGICAL_OR;
+
+	int result = result_reg(dst);
+	int first = compile_branch(expr->binary_lhs, is_or);
+	int second = compile_branch(expr->binary_rhs, is_or);
+	emit_imm(OP_LOADI, result, !is_or);
+	int end = emit_imm(OP_JMP, 0, 0);
+
+	patch(first);
+	patch(second);
+	emit_imm(OP_LOADI, result, is_or);
+	patch(end);
+	return result;
+}
+
+static int compile_binary(expr_t* expr, int dst)
+{
+	binary_operator_t operator = expr->binary_operator;
+	if(operator == BINARY_LOGICAL_AND || operator == BINARY_LOGICAL_OR)
+	{
+		return compile_logical(expr, dst);
+	}
+
+	int top = state.temps;
+
+	// Adding or subtracting a small constant is a single instruction.
+	expr_t* operand = NULL;
+	int32_t addend = 0;
+	if(operator == BINARY_ADD && is_small_literal(expr->binary_rhs, false))
+	{
+		operand = expr->binary_lhs;
+		addend = (int32_t)expr->binary_rhs->value;
+	}
+	else if(operator == BINARY_ADD && is_small_literal(expr->binary_lhs, false))
+	{
+		operand = expr->binary_rhs;
+		addend = (int32_t)expr->binary_lhs->value;
+	}
+	else if(operator == BINARY_SUB && is_small_literal(expr->binary_rhs, true))
+	{
+		operand = expr->binary_lhs;
+		addend = -(int32_t)expr->binary_rhs->value;
+	}
+
+	if(operand)
+	{
+		STAT_INC(vm_fused);
+		int value = compile_expr(operand, -1);
+		state.temps = top;
+		int result = result_reg(dst);
+		emit(OP_ADDI, result, value, (uint16_t)addend);
+		return result;
+	}
+
+	int lhs = compile_expr(expr->binary_lhs, -1);
+	int rhs = compile_expr(expr->binary_rhs, -1);
+	state.temps = top;
+	int result = result_reg(dst);
+	emit(binary_ops[operator], result, lhs, rhs);
+	return result;
+}
+
+// Compiles an expression, returning the register holding its value. This is
+// 'dst' if it is not negative, otherwise a temporary or a variable's own
+// register, which must not be written.
+static int compile_expr(expr_t* expr, int dst)
+{
+	switch(expr->type)
+	{
+	case EXPR_LITERAL: {
+		int result = result_reg(dst);
+		emit_imm(OP_LOADI, result, (int32_t)expr->value);
+		return result;
+	}
+	case EXPR_VAR: {
+		int reg = var_reg(expr->var_name);
+		if(dst >= 0 && dst != reg)
+		{
+			emit(OP_MOV, dst, reg, 0);
+			return dst;
+		}
+		return reg;
+	}
+	case EXPR_ASSIGNMENT: {
+		int reg = var_reg(expr->assign_name);
+		compile_expr(expr->assign_rhs, reg);
+		if(dst >= 0 && dst != reg)
+		{
+			emit(OP_MOV, dst, reg, 0);
+			return dst;
+		}
+		return reg;
+	}
+	case EXPR_UNARY: {
+		int top = state.temps;
+		int operand = compile_expr(expr->unary_operand, -1);
+		state.temps = top;
+
+		uint8_t op = OP_NEG;
+		switch(expr->unary_operator)
+		{
+		case UNARY_NEGATE:             op = OP_NEG;  break;
+		case UNARY_BITWISE_COMPLEMENT: op = OP_NOT;  break;
+		case UNARY_LOGICAL_NEGATE:     op = OP_LNOT; break;
+		default: UNHANDLED_CASE();
+		}
+
+		int result = result_reg(dst);
+		emit(op, result, operand, 0);
+		return result;
+	}
+	case EXPR_BINARY: {
+		return compile_binary(expr, dst);
+	}
+	default: {
+		UNHANDLED_CASE();
+	}
+	}
+}
+
+static void compile_stmt(stmt_t* stmt)
+{
+	state.temps = state.locals;
+
+	switch(stmt->type)
+	{
+	case STMT_RETURN: {
+		emit(OP_RET, compile_expr(stmt->return_expr, -1), 0, 0);
+	} break;
+	case STMT_EXPR: {
+		compile_expr(stmt->standalone_expr, -1);
+	} break;
+	case STMT_DECLARE: {
+		// Registers start out as zero, so a variable with no initializer
+		// needs no code.
+		int reg = state.locals++;
+		state.temps = state.locals;
+		use_registers(state.locals);
+
+		vm_var_t var = { stmt->declare_name, reg };
+		sb_push(state.vars, var);
+
+		if(stmt->declare_initializer)
+		{
+			compile_expr(stmt->declare_initializer, reg);
+		}
+	} break;
+	default: {
+		UNHANDLED_CASE();
+	} break;
+	}
+}
+
+// Compiles the body of a function to the end of the code, returning the
+// number of registers it uses.
+static int compile_function(decl_t* decl)
+{
+	sb_free(state.vars);
+	state.vars = NULL;
+	state.locals = 0;
+	state.temps = 0;
+	state.register_count = 1;
+	state.out_of_range = false;
+
+	for(int i = 0; i < decl->stmt_count; i++)
+	{
+		compile_stmt(decl->stmts[i]);
+	}
+
+	// Falling off the end returns zero, as 'main' does.
+	state.temps = state.locals;
+	int zero = alloc_temp();
+	emit_imm(OP_LOADI, zero, 0);
+	emit(OP_RET, zero, 0, 0);
+
+	sb_free(state.vars);
+	state.vars = NULL;
+	return state.register_count;
+}
+
+vm_program_t* vm_create()
+{
+	return calloc(1, sizeof(vm_program_t));
+}
+
+void vm_compile(vm_program_t* program, decl_t* decl)
+{
+	if(vm_lookup(program, decl->name) >= 0)
+	{
+		error("redefinition of '%s'\n", decl->name);
+	}
+
+	state.program = program;
+	int offset = sb_count(program->code);
+
+	state.fuse_branches = true;
+	int register_count = compile_function(decl);
+	if(state.out_of_range)
+	{
+		stb__sbn(program->code) = offset;
+		state.fuse_branches = false;
+		register_count = compile_function(decl);
+	}
+
+	vm_function_t function;
+	function.name = decl->name;
+	function.offset = offset;
+	function.register_count = register_count;
+	sb_push(program->functions, function);
+
+	state.program = NULL;
+}
+
+int vm_lookup(vm_program_t* program, const char* name)
+{
+	for(int i = 0; i < sb_count(program->functions); i++)
+	{
+		if(!strcmp(program->functions[i].name, name))
+		{
+			return i;
+		}
+	}
+	return -1;
+}
+
+//
+// Interpreter.
+//
+
+// Arithmetic wraps around as it does in the machine code, rather than being
+// undefined as in C.
+#define WRAP(a, op, b) ((int32_t)((uint32_t)(a) op (uint32_t)(b)))
+
+int32_t vm_run(vm_program_t* program, int function)
+{
+	// Each handler jumps straight to the next one, rather than returning to
+	// a single dispatch point, so every handler has its own indirect branch
+	// for the predictor to learn.
+	static const void* const dispatch[OP_COUNT] =
+	{
+		[OP_LOADI] = &&op_loadi,
+		[OP_MOV]   = &&op_mov,
+		[OP_ADD]   = &&op_add,
+		[OP_SUB]   = &&op_sub,
+		[OP_MUL]   = &&op_mul,
+		[OP_DIV]   = &&op_div,
+		[OP_MOD]   = &&op_mod,
+		[OP_AND]   = &&op_and,
+		[OP_OR]    = &&op_or,
+		[OP_XOR]   = &&op_xor,
+		[OP_SHL]   = &&op_shl,
+		[OP_SHR]   = &&op_shr,
+		[OP_LT]    = &&op_lt,
+		[OP_LE]    = &&op_le,
+		[OP_GT]    = &&op_gt,
+		[OP_GE]    = &&op_ge,
+		[OP_EQ]    = &&op_eq,
+		[OP_NE]    = &&op_ne,
+		[OP_NEG]   = &&op_neg,
+		[OP_NOT]   = &&op_not,
+		[OP_LNOT]  = &&op_lnot,
+		[OP_JMP]   = &&op_jmp,
+		[OP_JZ]    = &&op_jz,
+		[OP_JNZ]   = &&op_jnz,
+		[OP_RET]   = &&op_ret,
+		[OP_ADDI]  = &&op_addi,
+		[OP_JLT]   = &&op_jlt,
+		[OP_JLE]   = &&op_jle,
+		[OP_JGT]   = &&op_jgt,
+		[OP_JGE]   = &&op_jge,
+		[OP_JEQ]   = &&op_jeq,
+		[OP_JNE]   = &&op_jne
+	};
+
+	vm_function_t* f = &program->functions[function];
+	int32_t stack_registers[VM_STACK_REGISTERS];
+	int32_t* r = stack_registers;
+	if(f->register_count > VM_STACK_REGISTERS)
+	{
+		r = malloc(f->register_count * sizeof(int32_t));
+	}
+	memset(r, 0, f->register_count * sizeof(int32_t));
+	const vm_insn_t* ip = program->code + f->offset;
+	int32_t result;
+
+#define DISPATCH() goto *dispatch[ip->op]
+#define NEXT() do { ip++; DISPATCH(); } while(0)
+#define BINARY(name, expr) name: r[ip->a] = (expr); NEXT();
+#define BRANCH(name, cmp) name: if(r[ip->a] cmp r[ip->b]) { ip += (int16_t)ip->c; DISPATCH(); } NEXT();
+
+	DISPATCH();
+
+op_loadi:
+	r[ip->a] = ip->imm;
+	NEXT();
+op_mov:
+	r[ip->a] = r[ip->b];
+	NEXT();
+
+	BINARY(op_add, WRAP(r[ip->b], +, r[ip->c]))
+	BINARY(op_sub, WRAP(r[ip->b], -, r[ip->c]))
+	BINARY(op_mul, WRAP(r[ip->b], *, r[ip->c]))
+	BINARY(op_div, r[ip->b] / r[ip->c])
+	BINARY(op_mod, r[ip->b] % r[ip->c])
+	BINARY(op_and, r[ip->b] & r[ip->c])
+	BINARY(op_or,  r[ip->b] | r[ip->c])
+	BINARY(op_xor, r[ip->b] ^ r[ip->c])
+	// Shift counts are masked to five bits, as by 'sal' and 'sar'.
+	BINARY(op_shl, WRAP(r[ip->b], <<, r[ip->c] & 31))
+	BINARY(op_shr, r[ip->b] >> (r[ip->c] & 31))
+	BINARY(op_lt,  r[ip->b] <  r[ip->c])
+	BINARY(op_le,  r[ip->b] <= r[ip->c])
+	BINARY(op_gt,  r[ip->b] >  r[ip->c])
+	BINARY(op_ge,  r[ip->b] >= r[ip->c])
+	BINARY(op_eq,  r[ip->b] == r[ip->c])
+	BINARY(op_ne,  r[ip->b] != r[ip->c])
+	BINARY(op_neg, WRAP(0, -, r[ip->b]))
+	BINARY(op_not, ~r[ip->b])
+	BINARY(op_lnot, !r[ip->b])
+	BINARY(op_addi, WRAP(r[ip->b], +, (int16_t)ip->c))
+
+op_jmp:
+	ip += ip->imm;
+	DISPATCH();
+op_jz:
+	if(r[ip->a] == 0) { ip += ip->imm; DISPATCH(); }
+	NEXT();
+op_jnz:
+	if(r[ip->a] != 0) { ip += ip->imm; DISPATCH(); }
+	NEXT();
+
+	BRANCH(op_jlt, <)
+	BRANCH(op_jle, <=)
+	BRANCH(op_jgt, >)
+	BRANCH(op_jge, >=)
+	BRANCH(op_jeq, ==)
+	BRANCH(op_jne, !=)
+
+op_ret:
+	result = r[ip->a];
+	if(r != stack_registers)
+	{
+		free(r);
+	}
+	return result;
+
+#undef DISPATCH
+#undef NEXT
+#undef BINARY
+#undef BRANCH
+}
+
+void vm_destroy(vm_program_t* program)
+{
+	if(program == NULL)
+	{
+		return;
+	}
+	sb_free(program->code);
+	sb_free(program->functions);
+	free(program);
+}
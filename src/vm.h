@@ -0,0 +1,39 @@
+#ifndef _VM_H
+#define _VM_H
+
+#include <stdint.h>
+
+#include "parser.h"
+
+// Bytecode interpreter, which runs programs without generating any machine
+// code, for hosts where memory cannot be made executable.
+//
+// Functions are compiled to a register-based bytecode. Every local variable
+// has a register of its own and temporaries are allocated above them, so
+// reading a variable costs nothing. Common pairs of instructions are fused
+// into superinstructions: adding a small constant, and a comparison whose
+// only use is a branch.
+
+typedef struct vm_program vm_program_t;
+
+// Creates an empty program.
+vm_program_t* vm_create();
+
+// Compiles a function declaration into the program. The declaration is not
+// used once this returns.
+// If the function is already defined or uses an undeclared variable, the
+// program will terminate and an error message will be printed to the user.
+void vm_compile(vm_program_t* program, decl_t* decl);
+
+// Returns the index of the named function, or -1 if the program does not
+// define it.
+int vm_lookup(vm_program_t* program, const char* name);
+
+// Runs the function with the given index, returning its result.
+// As with native code, dividing by zero terminates the process.
+int32_t vm_run(vm_program_t* program, int function);
+
+// Releases the program.
+void vm_destroy(vm_program_t* program);
+
+#endif
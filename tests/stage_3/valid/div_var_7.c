@@ -0,0 +1,4 @@
+int main() {
+    int a = -1000;
+    return a / 7 + 200;
+}
\ No newline at end of file
@@ -0,0 +1,5 @@
+int main() {
+    int a;
+    a = -1000;
+    return a / -7;
+}
\ No newline at end of file
@@ -0,0 +1,5 @@
+int main() {
+    int a;
+    a = -1001;
+    return a / -8;
+}
\ No newline at end of file
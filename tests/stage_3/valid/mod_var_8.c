@@ -0,0 +1,4 @@
+int main() {
+    int a = -1001;
+    return a % 8 + 10;
+}
\ No newline at end of file
@@ -0,0 +1,6 @@
+int main() {
+    int a = -2147483647 - 1;
+    int b;
+    b = -5;
+    return a % (-2147483647 - 1) + b % (-2147483647 - 1) + 10;
+}
\ No newline at end of file
@@ -0,0 +1,5 @@
+int main() {
+    int a;
+    a = -999;
+    return a % -7 + 10;
+}
\ No newline at end of file
@@ -0,0 +1,5 @@
+int main() {
+    int a;
+    a = -1003;
+    return a % -8 + 10;
+}
\ No newline at end of file
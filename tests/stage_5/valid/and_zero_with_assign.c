@@ -0,0 +1,5 @@
+int main() {
+    int a = 1;
+    int b = 0 & (a = 7);
+    return a + b;
+}
\ No newline at end of file
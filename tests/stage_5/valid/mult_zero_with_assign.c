@@ -0,0 +1,5 @@
+int main() {
+    int a = 1;
+    int b = (a = 5) * 0;
+    return a + b;
+}
\ No newline at end of file
@@ -0,0 +1,4 @@
+int main() {
+    int a = -2147483647 - 1;
+    return -(-2147483647 - 1) == -a;
+}
\ No newline at end of file
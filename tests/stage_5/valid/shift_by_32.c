@@ -0,0 +1,4 @@
+int main() {
+    int a = 0;
+    return a && 1 << 32;
+}
\ No newline at end of file